@@ -33,6 +33,78 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <atomic>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+    /* The association list splitter's vector unit - -DNOSIMD for the plain C one */
+#if !defined(NOSIMD) && defined(__AVX2__)
+#define SPLIT_AVX2
+#include <immintrin.h>
+#elif !defined(NOSIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define SPLIT_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+#else
+#include <io.h>
+#include <fcntl.h>
+
+    /* No threads - anything 'started' just runs to completion there and then */
+typedef int pthread_t;
+typedef int pthread_mutex_t;
+typedef int pthread_cond_t;
+#define pthread_create(t, a, f, arg)    ((f)(arg), *(t) = 0)
+#define pthread_join(t, r)              ((void)0)
+#define pthread_mutex_init(m, a)        (*(m) = 0)
+#define pthread_mutex_destroy(m)        ((void)0)
+#define pthread_mutex_lock(m)           ((void)0)
+#define pthread_mutex_unlock(m)         ((void)0)
+#define PTHREAD_MUTEX_INITIALIZER       0
+#define pthread_cond_init(c, a)         (*(c) = 0)
+#define pthread_cond_destroy(c)         ((void)0)
+#define pthread_cond_wait(c, m)         ((void)0)
+#define pthread_cond_broadcast(c)       ((void)0)
+#endif
+
+ /* Handle strupr portability */
+#ifdef _MSC_VER
+    /* Microsoft compiler - use _strupr */
+#define STRUPR _strupr
+#else
+    /* GCC or other compilers - provide custom implementation */
+static char * strupr(char * s)
+{
+    char * p = s;
+    while (*p)
+    {
+        *p = toupper((unsigned char)*p);
+        p++;
+    }
+    return s;
+}
+#define STRUPR strupr
+#endif
 
 #ifndef bool
 #define bool int
@@ -40,17 +112,488 @@
 #define false 0
 #endif
 
+// One headword from an index file: the trimmed key plus its 'tot_rec tot_freq head tail' quad.
+//
+// Padded out to 64 bytes so that a probe into a HeadwordIndex touches a single cache line.
+//
+typedef struct
+{
+    char key[24];                        /* trimmed key - the index key column is 20 chars wide  */
+    int  tot_rec;                        /* number of different answers                           */
+    int  tot_freq;                       /* total count of all answers                            */
+    long head_address;                   /* offset of the headword line in the data file          */
+    long tail_address;                   /* offset of the association list in the data file       */
+    int  first;                          /* compiled snapshots: first SnapAssoc, -1 if bad address */
+    int  nassoc;                         /* compiled snapshots: number of SnapAssocs               */
+    char pad[64 - 24 - 4 * sizeof(int) - 2 * sizeof(long)];
+} IndexEntry;
+
+// Minimal perfect hash over the headwords of one index file (hash and displace).
+//
+// A key hashes (seed 0) to a bucket; the bucket's displacement is either a seed to rehash
+// the key with, or - for buckets holding a single key - the slot itself, stored as -slot-1.
+// Every key owns exactly one of the nkeys slots, so a lookup is two hashes and one probe.
+//
+typedef struct
+{
+    IndexEntry * table;                  /* nkeys entries, 64 byte aligned                        */
+    void       * raw;                    /* the allocation table lives in                         */
+    int        * disp;                   /* nbuckets displacements                                */
+    int          nkeys;
+    int          nbuckets;
+    IndexEntry * entries;                /* every line of the index, in file order (for -x)       */
+    int          nentries;
+} HeadwordIndex;
+
+// A read-only view of a whole file.  Where mmap is available the bytes are the page cache's
+// own (so every eatshow on the host shares one copy), otherwise they're read into the heap.
+//
+typedef struct
+{
+    const char * base;
+    size_t       size;
+    bool         mapped;                 /* base came from mmap rather than malloc                */
+} MappedFile;
+
+// An association list - 'WORD|count|WORD|count...' - as it sits in a mapped data file.  The
+// bytes are never copied or written to; len excludes the terminating newline.
+//
+typedef struct
+{
+    const char * ptr;
+    size_t       len;
+} Record;
+
+// One association in a compiled snapshot - the word is in the snapshot's string pool (and
+// is '\0' terminated there too).
+//
+typedef struct
+{
+    unsigned int word;                   /* offset of the word in the string pool                 */
+    unsigned int len;                    /* length of the word                                    */
+    int          count;
+} SnapAssoc;
+
+// Where one direction's arrays are in a compiled snapshot (offsets from the start of the file).
+// An entry's association list is assoc[first .. first + nassoc), CSR fashion.
+//
+typedef struct
+{
+    unsigned long long table;            /* nkeys IndexEntrys, in hash order                      */
+    unsigned long long disp;             /* nbuckets ints                                         */
+    unsigned long long entries;          /* nentries IndexEntrys, in index file order             */
+    unsigned long long assoc;            /* nassoc SnapAssocs                                     */
+    int                nkeys;
+    int                nbuckets;
+    int                nentries;
+    int                nassoc;
+} SnapSection;
+
+// The start of a compiled snapshot.  Every array in the file is 64 byte aligned, and is used
+// exactly as it was written - loading one is a mmap and one pass of checks (see snapSound).
+//
+typedef struct
+{
+    char               magic[8];         /* "EATSNAP"                                             */
+    unsigned int       version;
+    unsigned int       byteOrder;        /* 0x01020304 as written by the compiling machine        */
+    unsigned int       entrySize;        /* sizeof(IndexEntry) as compiled                        */
+    unsigned int       unused;
+    unsigned long long fileSize;
+    unsigned long long sources[4][2];    /* size and mtime of the four text files compiled        */
+    SnapSection        dir[2];           /* [0] is s-r, [1] is r-s                                */
+    unsigned long long pool;             /* the string pool                                       */
+    unsigned long long poolSize;
+    unsigned long long bodySum;          /* checksum of everything after the header               */
+    unsigned long long headSum;          /* checksum of the header, up to this field              */
+} SnapHeader;
+
+// A snapshot's body checksum taken a stretch at a time, so that snapSound can check what's
+// just been summed while it's still in cache.  It comes out the same as checksum over the lot.
+//
+typedef struct
+{
+    const unsigned char * at;            /* summed up to here                                     */
+    unsigned long long    h;
+} SnapSum;
+
+// A growable run of bytes.
+//
+typedef struct
+{
+    char * data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+// One of an Arena's blocks - its bytes follow it.
+//
+typedef struct ArenaBlock
+{
+    struct ArenaBlock * next;
+    size_t              size;
+} ArenaBlock;
+
+// A bump allocator, one per thread - see arenaAlloc.  Whatever a query needs for as long as it
+// runs (the lines it's read from, a -m association list) comes from here, and is all given
+// back at once when it's done.
+//
+typedef struct
+{
+    ArenaBlock * first;
+    ArenaBlock * cur;                    /* the block being allocated from                        */
+    size_t       used;                   /* ... and how much of it is                             */
+} Arena;
+
+// Where an Arena was up to - see arenaMark.
+//
+typedef struct
+{
+    ArenaBlock * block;
+    size_t       used;
+} ArenaMark;
+
+// A file that is only ever read a block at a time, through the buffer pool (-m mode).
+//
+typedef struct
+{
+    FILE * fp;
+    long   size;
+    int    id;                           /* tags the file's blocks in the pool                    */
+} PagedFile;
+
+// One buffer pool frame - a cached block of a PagedFile.
+//
+typedef struct
+{
+    int    file;                         /* PagedFile id, -1 while the frame is unused            */
+    long   block;
+    int    next;                         /* next frame on the same hash chain, -1 at the end      */
+    bool   ref;                          /* CLOCK reference bit                                   */
+    char * data;
+} Frame;
+
+// The -m mode's fixed set of frames, shared by every PagedFile, and replaced by CLOCK.
+//
+typedef struct
+{
+    Frame * frames;
+    int     nframes;
+    int     maxFrames;                   /* the budget's worth - nframes is less while loading    */
+    int     hand;                        /* where the CLOCK sweep resumes                         */
+    int   * chains;                      /* (file, block) hash -> first frame, nchains a power of 2 */
+    int     nchains;
+    long    hits;
+    long    misses;
+    long    bytesRead;
+    long    queries;
+    size_t  dirBytes;                    /* memory held by the PagedIndex directories             */
+} BufferPool;
+
+// The -m mode's stand-in for a HeadwordIndex - a directory of which block of the index file
+// each key is in, so that finding one reads a block (or two, if its line crosses into the
+// next) rather than the whole file.
+//
+// The index isn't in key order, so the directory can't just hold each block's first key.
+// Instead every key has one word: the top 40 bits of its hash over the 24 bit block number,
+// sorted, so a lookup is a binary search that yields the blocks to read in file order.
+//
+typedef struct
+{
+    PagedFile            file;
+    unsigned long long * dir;            /* ndir (hash << 24 | block) words, sorted               */
+    long                 ndir;
+    unsigned short     * lineStart;      /* per block, offset of its first line (0xFFFF if none)  */
+    long                 nblocks;
+    long                 end;            /* where parsing the index stopped                       */
+    IndexEntry           found;          /* the entry last found                                  */
+} PagedIndex;
+
+// One direction of the thesaurus - a mapped data file and its index, kept in memory.  When a
+// compiled snapshot is loaded, assoc and pool point into that instead and data is empty.  In
+// -m mode neither is resident - both files are paged through the buffer pool.
+//
+typedef struct
+{
+    char              mode;              /* 's' (stimulus -> response) or 'r' (response -> stimulus) */
+    MappedFile        data;
+    HeadwordIndex     index;
+    int               length;            /* number of headwords its index holds, as found on loading  */
+    const SnapAssoc * assoc;
+    const char      * pool;
+    bool              paged;             /* -m mode - pdata and pindex are used                       */
+    PagedFile         pdata;
+    PagedIndex        pindex;
+} Dataset;
+
+// Steps through one headword's associations, from whichever of the text or the compiled
+// forms its Dataset holds.
+//
+typedef struct
+{
+    const char      * pos;               /* text: the next 'WORD|count' pair                      */
+    const char      * end;               /* text: the end of the list, once its newline is found  */
+    const char      * block;             /* text: the 64 bytes mask covers                        */
+    unsigned long long mask;             /* text: separators ('|' or newline) in block still ahead */
+    const SnapAssoc * next;              /* compiled: the next association, NULL for text         */
+    const SnapAssoc * last;
+    const char      * pool;
+} AssocCursor;
+
+// How renderResult lays a result out - the -t, -n, -d and -l switches and --format, or, for
+// --serve, a request's own options.
+//
+typedef struct
+{
+    bool tabs;
+    bool number;
+    bool demark;
+    bool limited;
+    int  limit;
+    int  format;                         /* FORMAT_TEXT, or --format's jsonl, csv or bin          */
+} Layout;
+
+// A rendered result in the cache: its key (cue, direction and Layout), then - after the cue, in
+// the same block - its screen and echo text.
+//
+typedef struct CacheEntry
+{
+    struct CacheEntry * next;            /* in its hash chain                                     */
+    unsigned long long  hash;
+    char                mode;
+    Layout              layout;
+    bool                found;           /* whether cue is a headword                             */
+    bool                ref;             /* used since the hand last passed                       */
+    long                slot;            /* where it is in its shard's slots                      */
+    size_t              size;            /* the whole block, as counted against the budget        */
+    size_t              screenLen;
+    size_t              echoLen;
+    char                cue[1];
+} CacheEntry;
+
+// One shard of the result cache, with its own lock.  Entries are evicted, CLOCK fashion, by a
+// hand going round 'slots'.
+//
+typedef struct
+{
+    pthread_mutex_t  lock;
+    CacheEntry    ** chains;
+    CacheEntry    ** slots;
+    long             nslots;
+    long             cap;
+    long             hand;
+    size_t           bytes;
+    unsigned long    hits;
+    unsigned long    misses;
+    unsigned long    evictions;
+} CacheShard;
+
+// What the lookups on one thread have done, as they go - see 'tally'.  The times are only
+// kept with --stats.
+//
+typedef struct
+{
+    unsigned long long bytes;            /* of association lists read                             */
+    unsigned long long indexNs;          /* finding cues in the index                             */
+    unsigned long long seekNs;           /* getting to (and, -m, reading) their records           */
+    unsigned long long tokenizeNs;       /* splitting records into associations                   */
+    unsigned long long formatNs;         /* formatting the output                                 */
+    unsigned long      indexLines;       /* index entries or lines compared with cues             */
+    unsigned long      syscalls;         /* file reads (-m) and echo file writes                  */
+    unsigned long      records;          /* association lines output                              */
+    unsigned long      cues;
+    unsigned long      found;
+    unsigned long      cached;           /* cues copied from the result cache                     */
+    unsigned long      arenaAllocs;      /* allocations from the arena                            */
+    unsigned long long arenaBytes;       /* ... and the bytes they took                           */
+    unsigned long      mallocs;          /* arena blocks malloc'ed                                */
+} Tally;
+
+// One query in a --trace file.  The cue is cut short if it's longer than the record allows.
+//
+typedef struct
+{
+    long long      time;                 /* when it started, ns after the trace did               */
+    long long      latency;              /* ns                                                    */
+    unsigned char  mode;                 /* 's' or 'r'                                            */
+    unsigned char  flags;                /* TRACE_ bits - the Layout, and whether it was found    */
+    unsigned short cueLen;
+    int            limit;
+    char           cue[64];
+} TraceRecord;
+
+// A --trace file starts with this, and then has TraceRecords to its end.
+//
+typedef struct
+{
+    char         magic[8];               /* "EATTRACE"                                            */
+    unsigned int version;
+    unsigned int recordSize;             /* sizeof(TraceRecord)                                   */
+    unsigned int byteOrder;              /* 0x01020304 as written                                 */
+    unsigned int reserved;
+    long long    started;                /* when the trace started (seconds since 1970)           */
+} TraceHeader;
+
+// One slot of the --trace ring.  'seq' says whose turn it is: the producer claiming record n can
+// write it when seq == n, and the writer can take it when seq == n + 1.
+//
+typedef struct
+{
+    std::atomic<unsigned long> seq;
+    TraceRecord                rec;
+} TraceSlot;
+
+// --format=bin output starts with this, and then has a ColumnBlock for each cue.
+//
+typedef struct
+{
+    char         magic[8];               /* "EATCOLS"                                             */
+    unsigned int version;
+    unsigned int byteOrder;              /* 0x01020304 as written                                 */
+} ColumnHeader;
+
+// One cue's --format=bin block.  It's followed by the cue (padded to 4 bytes) and then its n
+// associations a column at a time: the counts (int), the proportions (float), where each word
+// ends in the words (unsigned int), and the words end to end (padded to 4 bytes).
+//
+typedef struct
+{
+    unsigned int size;                   /* bytes in the block after this field                   */
+    unsigned int flags;                  /* COLUMN_ bits                                          */
+    int          tot_rec;
+    int          tot_freq;
+    unsigned int n;
+    unsigned int cueLen;
+    unsigned int wordsLen;
+} ColumnBlock;
+
+// --stats: one cue's share of the tally.
+//
+typedef struct
+{
+    char * cue;
+    char   mode;
+    Tally  tally;
+} CueStats;
+
+// A --pipe or --serve request - see parseRequest.
+//
+typedef struct
+{
+    unsigned long id;
+    char        * cue;
+    char          mode;
+    Layout        layout;
+} Request;
+
+// Both directions, loaded once.  'cur' is whichever one -s/-r/-sw last selected.
+//
+typedef struct
+{
+    Dataset    sr;
+    Dataset    rs;
+    Dataset  * cur;
+    MappedFile snap;                     /* the compiled snapshot, if one was loaded              */
+    bool       loaded;
+} Engine;
+
 // Forward declarations.
 //
-static void doFileCloseOpen(char, FILE **, FILE **, int *);
+static void loadEngine(void);
+static void transposeDataset(Dataset *, Dataset *);
+static void loadGraph(void);
+static void loadSpread(void);
+static void loadNorms(void);
+static int graphNode(const char *);
+static void graphInfo(const char *);
+static bool renderGraph(char, const char *, const Layout *, Buffer *, Buffer *);
+static void freeWalk(void);
+static int workThreads(void);
+static void openDataset(Dataset *, char, const char *, const char *);
+static bool mapFile(const char *, MappedFile *);
+static void unmapFile(MappedFile *);
+static bool getRecord(const Dataset *, long, Record *);
+static unsigned long long sepMask(const char *, const char *);
+static void startSplit(AssocCursor *, const char *, const char *);
+static const char * nextSep(AssocCursor *);
+static int  parseCount(const char *, const char *);
+static bool nextPair(AssocCursor *, const char **, int *, int *);
+static bool openAssoc(Dataset *, const IndexEntry *, AssocCursor *);
+static bool nextAssoc(AssocCursor *, const char **, int *, int *);
+static const IndexEntry * findCue(Dataset *, const char *);
+static long parseIndexLine(const char *, const char *, IndexEntry *);
+static void initPool(long);
+static void reportPool(void);
+static void sizePool(void);
+static bool openPaged(const char *, PagedFile *, int);
+static long pagedRead(const PagedFile *, long, char *, long);
+static void openPagedDataset(Dataset *, char, const char *, const char *);
+static const IndexEntry * findPaged(Dataset *, const char *);
+static bool loadSnapshot(const char *);
+static bool snapFits(unsigned long long, unsigned long long, size_t);
+static void snapSumTo(SnapSum *, const void *);
+static bool snapEntriesSound(const IndexEntry *, int, int, SnapSum *);
+static bool snapSound(const SnapHeader *, size_t);
+static void compileSnapshot(const char *);
+static bool verifySnapshot(const char *);
+static unsigned long long checksum(const void *, size_t);
+static unsigned long long checksumWords(unsigned long long, const unsigned char *, size_t);
+static unsigned long long checksumEnd(unsigned long long, const unsigned char *, size_t);
+static void bufAppend(Buffer *, const void *, size_t);
+static void bufReserve(Buffer *, size_t);
+static void * arenaAlloc(size_t);
+static void * arenaGrow(void *, size_t, size_t);
+static ArenaMark arenaMark(void);
+static void arenaRelease(ArenaMark);
+static void arenaFree(void);
+static char * readLine(FILE *);
+static void buildIndex(HeadwordIndex *, FILE *);
+static void hashIndex(HeadwordIndex *, IndexEntry *, int);
+static const IndexEntry * lookupIndex(const HeadwordIndex *, const char *);
+static unsigned long long hashKey(const char *, unsigned int);
+static unsigned long long hashWord(const char *, int);
 static bool toggleDataBaseCheck(char *);
-static void out(char *, int, float);
+static void renderResult(Dataset *, const char *, const IndexEntry *, const Layout *, Buffer *, Buffer *);
+static void renderRecord(Dataset *, const char *, const IndexEntry *, const Layout *, Buffer *, Buffer *);
+static void bufJson(Buffer *, const char *, int);
+static void bufCsv(Buffer *, const char *, int);
+static void startFormat(void);
+static Layout switchLayout(void);
+static void emit(const char *, size_t, const char *, size_t);
+static void flushOutput(void);
+static void bufPrintf(Buffer *, const char *, ...);
+static void runBatch(const char *);
+static void runPipe(bool);
+static void runServer(const char *);
+static void runBench(const char *);
+static long long nowNs(void);
+static void emptyPool(void);
+static void emptyCache(void);
+static long long lap(long long *);
+static void statsCue(const char *, char, const Tally *);
+static void statsAdd(const Tally *);
+static void reportStats(void);
+static void startTrace(const char *);
+static void traceQuery(const char *, char, const Layout *, bool, long long, long long);
+static void runReplay(const char *);
+static void generateData(const char *, const char *);
+static void runSplitBench(int);
+static void putIndexLine(Buffer *, const char *, int, int, int, long, long);
+static bool rebuildIndex(const char *, const char *, bool);
+static const char * dataPath(const char *);
+static int  compareNs(const void *, const void *);
+static void tallyAdd(Tally *, const Tally *);
+static void tallySub(Tally *, const Tally *, const Tally *);
+static void initCache(void);
+static bool renderCue(Dataset *, const char *, const Layout *, Buffer *, Buffer *);
+static void cacheCounters(unsigned long *, unsigned long *, unsigned long *, unsigned long *, long *);
 static bool nothingEntered(char *);
 static void checkForWord(char *);
 static void checkInitRun(void);
 static void fromFile(char *);
 static bool dumpWords(char *);
 static void actOnFlag(char *);
+static int  actOnLongFlag(int, char **, int);
 static void resetFlags(void);
 static void trimLF(char *);
 static void trim(char *);
@@ -61,10 +604,24 @@ static const char * const SRFILE  = "./sr_concise";  /* file containing s-r data
 static const char * const RSFILE  = "./rs_concise";  /* file containing r-s data */
 static const char * const SRINDEX = "./sr_index";    /* s-r index file           */
 static const char * const RSINDEX = "./rs_index";    /* r-s index file           */
+static const char * const SNAPFILE = "./eatshow.snap"; /* compiled snapshot of all four */
+static const char * const BENCHFILE = "./eatshow.bench"; /* --bench results             */
+
+static const unsigned long GENBUCKET = 1 << 22;  /* --generate: pairs in each spilled run   */
+
+static const unsigned int SNAPVERSION = 1;   /* bump when the snapshot layout changes  */
+static const int SNAPBLOCK = 1024;       /* snapshot entries or associations checked per sum  */
 
-static const int SRLENGTH = 8211;        /* number of headwords in s-r data                    */
-static const int RSLENGTH = 22776;       /* number of headwords in r-s data                    */
-static const int MAXBUF   = 10000;       /* Maximum buffer size for words or association lists */
+static const size_t ARENABLOCK = 1 << 16;  /* bytes in an arena block (unless more are needed) */
+
+static const int  OUTSLOTS = 4;          /* output Buffers the writer thread can be behind     */
+static const long OUTCHUNK = 1 << 18;    /* bytes gathered before one is handed to it         */
+
+static const int BLOCKSIZE = 4096;       /* -m mode: bytes in a buffer pool block              */
+
+static const int  CACHESHARDS = 16;      /* result cache: shards (a power of 2), and            */
+static const long CACHECHAINS = 1024;    /* hash chains in each                                 */
+static const long CACHEKB     = 8192;    /* its size if there's no -c (or -m)                   */
 
 static const int WORD_FOUND = 0;         /* 'cue' found in the database             */
 
@@ -74,16 +631,99 @@ static bool bNumber  = false;            /* number the ouputs
 static bool binitRun = true;             /* first run of this application?          */
 static bool bDemark  = true;             /* demark (~~~~) results?                  */
 static bool bLimit   = false;            /* limit output to nLimit entries?         */
+static bool bPrefault = false;           /* fault data files in (and use huge pages)? */
+static bool bTextOnly = false;           /* ignore any compiled snapshot?           */
+static bool bTranspose = false;          /* derive r-s from s-r, not its own files? */
 
 static int nLimit    = 0;
+static int nThreads  = 1;                /* -j threads rendering a -b batch          */
+static long nBudget  = 0;                /* -m memory budget in KB (0: all resident) */
+static long nCache   = -1;               /* -c result cache size in KB (-1: default) */
 
 static char * echoFile = NULL;           /* default file to echo to is NULL         */
 static char * inptFile = NULL;           /* file to read instructions from          */
+static char * batchFile = NULL;          /* -b word list to look up as one batch    */
+
+static int pipeMode = 0;                 /* --pipe: 1 for tab-separated, 2 for binary frames */
+static char * serveSocket = NULL;        /* --serve: the daemon's socket             */
+static char * benchFile = NULL;          /* --bench: where the results go            */
+static char * dataDir = NULL;            /* --data: where the four files are         */
+
+static Engine engine;                    /* both databases, resident once loaded    */
+
+static BufferPool bufferPool;            /* -m mode's block cache                   */
+
+static thread_local Tally tally;         /* this thread's lookups, for --bench/--stats */
+static thread_local Arena arena;         /* this thread's per-query allocations     */
+
+static int        statsMode  = 0;        /* --stats: 1 for a summary, 2 for JSON     */
+static Tally      statsTotal;            /* every thread's tally, as cues finish     */
+static CueStats * cueStats   = NULL;
+static long       ncueStats  = 0;
+static long       capCueStats = 0;
+
+static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+
+static const unsigned int TRACEVERSION = 1;
+static const unsigned long TRACESLOTS  = 16384;  /* in the ring - a power of 2              */
+
+static const int TRACE_TABS    = 1;      /* TraceRecord flags                        */
+static const int TRACE_NUMBER  = 2;
+static const int TRACE_DEMARK  = 4;
+static const int TRACE_LIMITED = 8;
+static const int TRACE_FOUND   = 16;
+
+static FILE      * traceFile  = NULL;    /* --trace: where the records go            */
+static TraceSlot * traceRing  = NULL;
+static long long   traceStart = 0;
+static unsigned long traceTail = 0;      /* next record for the writer (its alone)   */
+static pthread_t   traceWriter;
+
+static std::atomic<unsigned long> traceHead(0);      /* next record to be claimed      */
+static std::atomic<unsigned long> traceDropped(0);   /* records lost to a full ring    */
+static std::atomic<int>           traceStop(0);
+
+static const int FORMAT_TEXT  = 0;       /* --format: the Layout's format            */
+static const int FORMAT_JSONL = 1;
+static const int FORMAT_CSV   = 2;
+static const int FORMAT_BIN   = 3;
+
+static const unsigned int COLUMNVERSION = 1;
+static const unsigned int COLUMN_FOUND  = 1;  /* ColumnBlock flags                       */
+static const unsigned int COLUMN_RS     = 2;
+
+static int outFormat = 0;                /* --format: FORMAT_TEXT unless it's used   */
+
+static const int GRAPH_EXPAND = 1;       /* --expand: cues are answered from the graph  */
+static const int GRAPH_PATH   = 2;       /* --path: ... and are pairs of words        */
+static const int GRAPH_ACTIVATE = 3;     /* --activate: ... and are seeds to spread from */
+static const int GRAPH_SIMILAR = 4;      /* --similar: ... and are matched to headwords */
+static const int MAXITERATIONS = 1000;   /* --activate's power iteration gives up after */
+
+static const int METRIC_COSINE  = 0;     /* --metric: how --similar compares lists   */
+static const int METRIC_JACCARD = 1;
+static const int METRIC_JS      = 2;
+
+static const char * const metricNames[] = { "cosine", "jaccard", "js" };
+static const int GRAPHTOPK    = 20;      /* words a graph query lists, without -l     */
+
+static int    graphQuery = 0;            /* GRAPH_EXPAND, GRAPH_PATH... or 0 to look cues up */
+static int    expandHops = 2;            /* --expand: associations in the longest chain */
+static int    beamWidth  = 256;          /* --beam: words each hop goes on from (0: all) */
+static double minScore   = 0.00001;      /* --threshold: chains scoring less are dropped */
+static double restartProb = 0.15;        /* --restart: --activate's share back to the seeds */
+static double tolerance  = 0.000001;     /* --tolerance: when --activate has converged */
+static bool   bPush      = false;        /* --push: --activate pushes from a single seed */
+static int    similarity = 0;            /* --metric: METRIC_COSINE... for --similar  */
+static double * rowNorm[2] = { NULL, NULL }; /* --similar: each list's norm, by direction */
 
-static FILE * fp  = NULL;                /* main db file                            */
-static FILE * fp1 = NULL;                /* index file for whatever fp points to    */
+static thread_local bool bBatchThread = false; /* this is one of runBatch's -j threads */
 
-static int index_length = 0;
+static char * replayFile = NULL;         /* --replay: the trace to replay            */
+static bool   bReplayMax = false;        /* ... as fast as possible                  */
+
+static CacheShard resultCache[CACHESHARDS]; /* rendered results, by cue and Layout   */
+static size_t     cacheBudget = 0;       /* bytes per shard - 0 if there's no cache */
     
 // Entry point.
 //
@@ -101,9 +741,18 @@ int main(int argc, char * argv[])
     {
         if(*argv[i] == '-')
         {
-            // actOnFlag won't return if -i used.
-            //
-            actOnFlag(argv[i]);
+            if(argv[i][1] == '-')
+            {
+                // Long options - these may consume the args that follow them.
+                //
+                i = actOnLongFlag(argc, argv, i);
+            }
+            else
+            {
+                // actOnFlag won't return if -i used.
+                //
+                actOnFlag(argv[i]);
+            }
         }
         else
         {
@@ -120,16 +769,89 @@ int main(int argc, char * argv[])
         }
     }
 
-    // actOnFlag may have altered sourcef from the default 's' (use the stimulus db)        
-    // AND, we need to make sure we've a db open - this routine does that.
+    // Both dbs are opened and indexed once only (main is re-entered for each line of an -i file).
+    //
+    loadEngine();
+    
+    // actOnFlag may have altered sourcef from the default 's' (use the stimulus db).
+    //
+    engine.cur = sourcef == 'r' ? &engine.rs : &engine.sr;
+    
+    // Graph queries build the graph first, once - and have no binary format.
+    //
+    if(graphQuery != 0)
+    {
+        if(outFormat == FORMAT_BIN)
+        {
+            fprintf(stderr, "eatshow: --format=bin is only for lookups\n");
+            
+            exit(1);
+        }
+        
+        loadGraph();
+        
+        if(graphQuery == GRAPH_ACTIVATE)
+        {
+            loadSpread();
+        }
+        
+        if(graphQuery == GRAPH_SIMILAR && similarity == METRIC_COSINE)
+        {
+            loadNorms();
+        }
+    }
+    
+    // --format's header, if it has one, before any results.
     //
-    doFileCloseOpen(sourcef, &fp, &fp1, &index_length);
+    if(batchFile != NULL || (pipeMode == 0 && serveSocket == NULL && benchFile == NULL && replayFile == NULL))
+    {
+        startFormat();
+    }
+    
+    if(batchFile != NULL)
+    {
+        runBatch(batchFile);
+        
+        return 0;
+    }
+    
+    if(pipeMode != 0)
+    {
+        runPipe(pipeMode == 2);
+        
+        return 0;
+    }
+    
+    if(serveSocket != NULL)
+    {
+        runServer(serveSocket);
+        
+        return 0;
+    }
+    
+    if(benchFile != NULL)
+    {
+        runBench(benchFile);
+        
+        return 0;
+    }
+    
+    if(replayFile != NULL)
+    {
+        runReplay(replayFile);
+        
+        return 0;
+    }
     
     // The leading switches are done - but are there are other args? They
     // should be words or the -switch dbs' flag if there are.
     //
     {
-        char cue[MAXBUF]; 
+        char * cue;
+        
+        // Each line (of any length) comes from the arena, and is given back once it's done.
+        //
+        ArenaMark mark = arenaMark();
 
         // i was set up in the for loop above - that loop may have exited before it
         // reached argc's value - see ** for why.
@@ -140,6 +862,21 @@ int main(int argc, char * argv[])
         {
             while(i < argc)
             {
+                // --path takes its words in pairs.
+                //
+                if(graphQuery == GRAPH_PATH && *argv[i] != '-' && i + 1 < argc && *argv[i + 1] != '-')
+                {
+                    char * pair = (char *)arenaAlloc(strlen(argv[i]) + strlen(argv[i + 1]) + 2);
+                    
+                    sprintf(pair, "%s\t%s", argv[i], argv[i + 1]);
+                    
+                    checkForWord(pair);
+                    
+                    i += 2;
+                    
+                    continue;
+                }
+                
                 // Also checks for runtime switches.
                 //
                 checkForWord(argv[i++]);
@@ -152,11 +889,16 @@ int main(int argc, char * argv[])
         else
         {
             // As printf returns the number of chars output, it works quite well
-            // when used in an && like this.
+            // when used in an && like this.  There's no prompt with --format - it would only get
+            // in the way of the records.
             //
-            while(printf("Enter a word>") && fgets(cue, MAXBUF, stdin) != NULL && !nothingEntered(cue))
+            while((outFormat != FORMAT_TEXT || printf("Enter a word>")) && (cue = readLine(stdin)) != NULL && !nothingEntered(cue))
             {
                 checkForWord(cue);
+                
+                flushOutput();
+                
+                arenaRelease(mark);
             }
             
             return 0;
@@ -166,244 +908,9684 @@ int main(int argc, char * argv[])
 
 
 
-// Opens appropriate data and index files - closes any that are already open first.
+// Loads both the stimulus and the response dbs - from the compiled snapshot if there's a
+// usable one, else by mapping the data files and reading their indexes into memory.  Does
+// nothing if that's already been done.
 //
-static void doFileCloseOpen(char sourcef, FILE ** fp, FILE ** fp1, int * index_length)
+static void loadEngine(void)
 {
-    if(*fp != NULL)
+    if(engine.loaded)
     {
-        fclose(*fp);
+        return;
     }
     
-    if(*fp1 != NULL)
+    if(bTranspose)
     {
-        fclose(*fp1);
+        openDataset(&engine.sr, 's', dataPath(SRFILE), dataPath(SRINDEX));
+        
+        transposeDataset(&engine.sr, &engine.rs);
     }
-    
-    if(sourcef == 's')
+    else if(nBudget > 0)
     {
-        if((*fp = fopen(SRFILE, "r")) == NULL)
-        {
-            fprintf(stderr, "cannot access the file: %s\n", SRFILE);
-            
-            exit(1);
-        }
-
-        if((*fp1 = fopen(SRINDEX, "r")) == NULL)
-        {
-            fprintf(stderr, "cannot access the file: %s\n", SRINDEX);
-            
-            exit(1);
-        }
-
-        *index_length = SRLENGTH;
+        initPool(nBudget * 1024);
+        
+        openPagedDataset(&engine.sr, 's', dataPath(SRFILE), dataPath(SRINDEX));
+        openPagedDataset(&engine.rs, 'r', dataPath(RSFILE), dataPath(RSINDEX));
+        
+        sizePool();
     }
-
-    if(sourcef == 'r')
+    else if(bTextOnly || !loadSnapshot(dataPath(SNAPFILE)))
     {
-        if((*fp = fopen(RSFILE, "r")) == NULL)
-        {
-            fprintf(stderr, "cannot access the file: %s\n", RSFILE);
-            
-            exit(1);
-        }
-
-        if((*fp1 = fopen(RSINDEX, "r")) == NULL)
-        {
-            fprintf(stderr, "cannot access the file: %s\n", RSINDEX);
-            
-            exit(1);
-        }
-
-        *index_length = RSLENGTH;
+        openDataset(&engine.sr, 's', dataPath(SRFILE), dataPath(SRINDEX));
+        openDataset(&engine.rs, 'r', dataPath(RSFILE), dataPath(RSINDEX));
     }
     
+    engine.cur    = &engine.sr;
+    engine.loaded = true;
+    
+    initCache();
+    
     return;
 }
 
 
 
-// Used to output stuff to the screen and, optionally, to a file.
+// Maps a data file (which stays mapped) and builds the in-memory index from its index file.
 //
-static void out(char * out1, int count, float prop)
+static void openDataset(Dataset * ds, char mode, const char * dataFile, const char * indexFile)
 {
-    const char * format = NULL;
-    
-    // Determine whether to use spaces or tabs in the output.
-    //    
-    format = bTabPad ? "%s\t%d\t%.2f\n" : "%-25s %3d %5.2f\n";
+    FILE * fpIndex = NULL;
     
-    printf(format, out1, count, prop);
+    ds->mode = mode;
     
-    // Been given a file name to echo output to?
-    //
-    if(echoFile != NULL)
+    if(!mapFile(dataFile, &ds->data))
     {
-        // YES.
+        fprintf(stderr, "cannot access the file: %s\n", dataFile);
         
-        FILE * ech = NULL;
+        exit(1);
+    }
+
+    if((fpIndex = fopen(indexFile, "r")) == NULL)
+    {
+        fprintf(stderr, "cannot access the file: %s\n", indexFile);
         
-        if((ech = fopen(echoFile, "a")) != NULL)
-        {
-            fprintf(ech, format, out1, count, prop);
-        }
-        fclose(ech);
-    }    
+        exit(1);
+    }
+    
+    buildIndex(&ds->index, fpIndex);
+    
+    fclose(fpIndex);
+    
+    ds->length = ds->index.nentries;
     
     return;
-}                        
+}
 
 
 
-// The functionally 'main' routine - checks in the index/data files for relevant data and outputs it.
+// Maps a whole file read-only.  Lookups land all over the data files, so the kernel is told
+// not to bother reading ahead - unless -p was given, in which case every page is faulted in
+// up front (and backed by huge pages where the kernel will do that for file mappings).
 //
-static void checkForWord(char * cue)
+// Returns: false if the file couldn't be opened or read.
+//
+static bool mapFile(const char * name, MappedFile * mf)
 {
-    int count;
-    int fail     = 3;  // 3 = 'cue' word not found.
-    int tot_rec  = 0;
-    int tot_freq = 0;
-    
-    float prop   = 0;
-    
-	long int tail_address = 0;
-    long int head_address = 0;
-
-    char * out1;
-    char * out2;
-    char response_word[MAXBUF];
-    char index_word   [MAXBUF];    
+#ifndef _WIN32
+    struct stat st;
     
-    doFileCloseOpen(sourcef, &fp, &fp1, &index_length);
+    int   fd;
+    int   flags = MAP_SHARED;
+    void * p;
     
-    // Check that cue isn't either the 'toggle db' or 'dump index words' flags.
-    //
-    if(toggleDataBaseCheck(cue) || dumpWords(cue))
+    if((fd = open(name, O_RDONLY)) == -1)
     {
-        return;
+        return false;
     }
     
-    trimLF(cue);
+    if(fstat(fd, &st) == -1)
+    {
+        close(fd);
+        
+        return false;
+    }
     
-    strupr(cue);
-
-    printf("\nLooking for: %s in %s MODE\n\n", cue, sourcef == 'r' ? "RESPONSE" : "STIMULUS");
+    mf->size   = (size_t)st.st_size;
+    mf->base   = "";
+    mf->mapped = false;
     
-    while(!feof(fp1))
-    { 
-        if(fgets(index_word, 21, fp1) == NULL)
+    if(mf->size == 0)
+    {
+        close(fd);
+        
+        return true;
+    }
+    
+#ifdef MAP_POPULATE
+    if(bPrefault)
+    {
+        flags |= MAP_POPULATE;
+    }
+#endif
+
+    p = mmap(NULL, mf->size, PROT_READ, flags, fd, 0);
+    
+    close(fd);
+    
+    if(p == MAP_FAILED)
+    {
+        return false;
+    }
+    
+    if(bPrefault)
+    {
+        madvise(p, mf->size, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+        madvise(p, mf->size, MADV_HUGEPAGE);
+#endif
+    }
+    else
+    {
+        madvise(p, mf->size, MADV_RANDOM);
+    }
+    
+    mf->base   = (const char *)p;
+    mf->mapped = true;
+    
+    return true;
+#else
+    FILE * f;
+    char * p;
+    long   n;
+    
+    if((f = fopen(name, "rb")) == NULL)
+    {
+        return false;
+    }
+    
+    fseek(f, 0, SEEK_END);
+    
+    n = ftell(f);
+    
+    rewind(f);
+    
+    if(n < 0 || (p = (char *)malloc(n + 1)) == NULL || fread(p, 1, n, f) != (size_t)n)
+    {
+        fclose(f);
+        
+        return false;
+    }
+    
+    fclose(f);
+    
+    mf->base   = p;
+    mf->size   = (size_t)n;
+    mf->mapped = false;
+    
+    return true;
+#endif
+}
+
+
+
+// Unmaps (or frees) a file mapped by mapFile.
+//
+static void unmapFile(MappedFile * mf)
+{
+#ifndef _WIN32
+    if(mf->mapped)
+    {
+        munmap((void *)mf->base, mf->size);
+    }
+#else
+    free((void *)mf->base);
+#endif
+
+    mf->base   = "";
+    mf->size   = 0;
+    mf->mapped = false;
+    
+    return;
+}
+
+
+
+// Gets the association list that starts at 'address' in a dataset's data file.
+//
+// Returns: false if address is outside the file.
+//
+static bool getRecord(const Dataset * ds, long address, Record * rec)
+{
+    const char * end;
+    
+    if(address < 0 || (size_t)address >= ds->data.size)
+    {
+        return false;
+    }
+    
+    rec->ptr = ds->data.base + address;
+    
+    if((end = (const char *)memchr(rec->ptr, '\n', ds->data.size - address)) == NULL)
+    {
+        end = ds->data.base + ds->data.size;
+    }
+    
+    rec->len = end - rec->ptr;
+    
+    return true;
+}
+
+
+
+// Finds the separators - '|' and newline - in the 64 bytes at p: bit i of the result is set
+// if p[i] is one.  Fewer than 64 bytes before 'end' are copied out first, so nothing past the
+// end of a mapping (or a Buffer) is ever read.
+//
+static unsigned long long sepMask(const char * p, const char * end)
+{
+    unsigned long long mask = 0;
+    
+    char tail[64];
+    
+    if(end - p < 64)
+    {
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, p, end - p);
+        
+        p = tail;
+    }
+
+#if defined(SPLIT_AVX2)
+    {
+        const __m256i bar = _mm256_set1_epi8('|');
+        const __m256i nl  = _mm256_set1_epi8('\n');
+        
+        __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+        
+        mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(lo, bar), _mm256_cmpeq_epi8(lo, nl)))
+             | (unsigned long long)(unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(hi, bar), _mm256_cmpeq_epi8(hi, nl))) << 32;
+    }
+#elif defined(SPLIT_SSE2)
+    {
+        const __m128i bar = _mm_set1_epi8('|');
+        const __m128i nl  = _mm_set1_epi8('\n');
+        
+        int i;
+        
+        for(i = 0; i < 4; i++)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + i * 16));
+            
+            mask |= (unsigned long long)(unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, bar), _mm_cmpeq_epi8(v, nl))) << (i * 16);
+        }
+    }
+#else
+    {
+        int i;
+        
+        for(i = 0; i < 64; i++)
+        {
+            mask |= (unsigned long long)(p[i] == '|' || p[i] == '\n') << i;
+        }
+    }
+#endif
+    
+    return mask;
+}
+
+
+
+// Starts the splitter on a text association list that begins at p - 'end' is only how far
+// it may be read, the list itself stops at its newline.
+//
+static void startSplit(AssocCursor * cur, const char * p, const char * end)
+{
+    cur->pos   = p;
+    cur->end   = end;
+    cur->block = p;
+    cur->mask  = p < end ? sepMask(p, end) : 0;
+    cur->next  = NULL;
+}
+
+
+
+// The splitter's next separator - a 64 byte block's worth of them are found at once, and
+// then handed out a bit at a time.
+//
+// Returns: the separator, or the cursor's end if there are no more.
+//
+static const char * nextSep(AssocCursor * cur)
+{
+    while(cur->mask == 0)
+    {
+        cur->block += 64;
+        
+        if(cur->block >= cur->end)
+        {
+            return cur->end;
+        }
+        
+        cur->mask = sepMask(cur->block, cur->end);
+    }
+    
+    {
+#ifdef _MSC_VER
+        unsigned long bit;
+        
+        _BitScanForward64(&bit, cur->mask);
+#else
+        int bit = __builtin_ctzll(cur->mask);
+#endif
+        const char * sep = cur->block + bit;
+        
+        cur->mask &= cur->mask - 1;
+        
+        return sep < cur->end ? sep : cur->end;
+    }
+}
+
+
+
+// Reads the count between p and end.  Counts are a few plain digits, which are taken without
+// a branch per digit; anything else is read as atoi would have.
+//
+static int parseCount(const char * p, const char * end)
+{
+    unsigned int n   = 0;
+    unsigned int bad = 0;
+    
+    const char * q;
+    
+    bool neg = false;
+    
+    if(end - p > 0 && end - p <= 9)
+    {
+        for(q = p; q < end; q++)
+        {
+            unsigned int d = (unsigned int)(unsigned char)*q - '0';
+            
+            bad |= d > 9;
+            n    = n * 10 + d;
+        }
+        
+        if(!bad)
+        {
+            return (int)n;
+        }
+    }
+    
+    for(n = 0; p < end && isspace((unsigned char)*p); p++)
+        ;
+    
+    if(p < end && (*p == '-' || *p == '+'))
+    {
+        neg = *p++ == '-';
+    }
+    
+    for(; p < end && isdigit((unsigned char)*p); p++)
+    {
+        n = n * 10 + (*p - '0');
+    }
+    
+    return neg ? -(int)n : (int)n;
+}
+
+
+
+// Steps through a text association list a 'WORD|count' pair at a time, without touching the
+// bytes - word/wordLen point back into the list.
+//
+// Returns: false when there are no more pairs.
+//
+static bool nextPair(AssocCursor * cur, const char ** word, int * wordLen, int * count)
+{
+    const char * p = cur->pos;
+    const char * bar;
+    const char * stop;
+    
+    if(p >= cur->end)
+    {
+        return false;
+    }
+    
+    // A word without its '|' (or none at all) is the end of the list.
+    //
+    if((bar = nextSep(cur)) >= cur->end || *bar != '|')
+    {
+        cur->pos = cur->end = bar;
+        
+        return false;
+    }
+    
+    stop = nextSep(cur);
+    
+    *word    = p;
+    *wordLen = (int)(bar - p);
+    *count   = parseCount(bar + 1, stop);
+    
+    if(stop < cur->end && *stop == '|')
+    {
+        cur->pos = stop + 1;
+    }
+    else
+    {
+        cur->pos = cur->end = stop;
+    }
+    
+    tally.bytes += cur->pos - p;
+    
+    return true;
+}
+
+
+
+// Starts a cursor on the associations of an index entry.
+//
+// Returns: false if the entry's address isn't in the data file.
+//
+static bool openAssoc(Dataset * ds, const IndexEntry * entry, AssocCursor * cur)
+{
+    if(ds->paged)
+    {
+        // Copy the list out of the pool, a block at a time up to its newline, into the arena -
+        // however long it is.
+        //
+        long   addr = entry->tail_address;
+        long   len  = 0;
+        long   cap  = 0;
+        char * list = NULL;
+        
+        if(addr < 0 || addr >= ds->pdata.size)
+        {
+            return false;
+        }
+        
+        while(addr < ds->pdata.size)
+        {
+            const char * nl;
+            long         n;
+            
+            if(len + BLOCKSIZE > cap)
+            {
+                list = (char *)arenaGrow(list, cap, cap * 2 > len + BLOCKSIZE ? cap * 2 : len + BLOCKSIZE);
+                cap  = cap * 2 > len + BLOCKSIZE ? cap * 2 : len + BLOCKSIZE;
+            }
+            
+            if((n = pagedRead(&ds->pdata, addr, list + len, BLOCKSIZE - addr % BLOCKSIZE)) <= 0)
+            {
+                break;
+            }
+            
+            if((nl = (const char *)memchr(list + len, '\n', n)) != NULL)
+            {
+                len = nl - list;
+                
+                break;
+            }
+            
+            len  += n;
+            addr += n;
+        }
+        
+        startSplit(cur, list, list + len);
+        
+        return true;
+    }
+    
+    if(ds->assoc != NULL)
+    {
+        if(entry->first < 0)
+        {
+            return false;
+        }
+        
+        cur->next = ds->assoc + entry->first;
+        cur->last = cur->next + entry->nassoc;
+        cur->pool = ds->pool;
+        
+        tally.bytes += entry->nassoc * sizeof(SnapAssoc);
+        
+        return true;
+    }
+    
+    // The list's newline is found as it's split, so it's bounded only by the file.
+    //
+    if(entry->tail_address < 0 || (size_t)entry->tail_address >= ds->data.size)
+    {
+        return false;
+    }
+    
+    startSplit(cur, ds->data.base + entry->tail_address, ds->data.base + ds->data.size);
+    
+    return true;
+}
+
+
+
+// Gets the next association from a cursor started by openAssoc.
+//
+// Returns: false when there are no more.
+//
+static bool nextAssoc(AssocCursor * cur, const char ** word, int * wordLen, int * count)
+{
+    if(cur->next == NULL)
+    {
+        return nextPair(cur, word, wordLen, count);
+    }
+    
+    if(cur->next == cur->last)
+    {
+        return false;
+    }
+    
+    *word    = cur->pool + cur->next->word;
+    *wordLen = (int)cur->next->len;
+    *count   = cur->next->count;
+    
+    tally.bytes += *wordLen;
+    
+    cur->next++;
+    
+    return true;
+}
+
+
+
+// One Buffer's worth of output on its way to the writer thread - [0] for stdout and [1] for
+// the echo file.
+//
+typedef struct
+{
+    Buffer out[2];
+    int    echoFd;                       /* where out[1] goes, -1 if there's no -f              */
+} OutSlot;
+
+// The output writer - emit fills slots[queued % OUTSLOTS] and its thread writes them, in
+// order, up to (but not including) queued.
+//
+typedef struct
+{
+    OutSlot         slots[OUTSLOTS];
+    unsigned long   queued;              /* slots handed to the thread                            */
+    unsigned long   written;             /* ... and written by it                                 */
+    bool            started;
+    int             echoFd;              /* the -f file, opened once                              */
+    char          * echoName;
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  ready;               /* queued has moved on                                   */
+    pthread_cond_t  drained;             /* written has moved on                                  */
+} Writer;
+
+static Writer writer;
+
+
+
+// Appends 'value' right aligned in 'width' characters, as "%*d" would.
+//
+static char * putInt(char * p, int value, int width)
+{
+    char               digits[12];
+    int                n   = 0;
+    unsigned long long v   = value < 0 ? -(long long)value : value;
+    
+    do
+    {
+        digits[n++] = (char)('0' + v % 10);
+        
+        v /= 10;
+    }
+    while(v != 0);
+    
+    if(value < 0)
+    {
+        digits[n++] = '-';
+    }
+    
+    for(width -= n; width > 0; width--)
+    {
+        *p++ = ' ';
+    }
+    
+    while(n > 0)
+    {
+        *p++ = digits[--n];
+    }
+    
+    return p;
+}
+
+
+
+// Appends a proportion right aligned in 'width' characters, as "%*.2f" would.  A float's
+// exact value is mantissa * 2^exponent, so it's rounded to hundredths (half to even, as printf
+// does) with integer arithmetic alone.  Anything that isn't a proportion (negative, -0, huge,
+// NaN) goes to snprintf.
+//
+static char * putProp(char * p, float prop, int width)
+{
+    int          exponent;
+    float        fraction = frexpf(prop, &exponent);
+    unsigned int hundredths;
+    
+    if(!(prop >= 0 && prop < 1000000.0f) || signbit(prop))
+    {
+        return p + snprintf(p, 32, "%*.2f", width, prop);
+    }
+    
+    // Under 2^-30 is under half a hundredth.  Above, prop < 2^20 so the shift is 5 to 54.
+    //
+    if(prop == 0 || exponent < -30)
+    {
+        hundredths = 0;
+    }
+    else
+    {
+        unsigned long long scaled = (unsigned long long)ldexpf(fraction, 24) * 100;
+        int                shift  = 24 - exponent;
+        unsigned long long half   = 1ULL << (shift - 1);
+        unsigned long long rest   = scaled & ((half << 1) - 1);
+        
+        hundredths = (unsigned int)(scaled >> shift);
+        
+        if(rest > half || (rest == half && (hundredths & 1)))
+        {
+            hundredths++;
+        }
+    }
+    
+    {
+        char digits[16];
+        int  n = 0;
+        
+        do
+        {
+            digits[n++] = (char)('0' + hundredths % 10);
+            
+            hundredths /= 10;
+            
+            if(n == 2)
+            {
+                digits[n++] = '.';
+            }
+        }
+        while(hundredths != 0 || n < 4);
+        
+        for(width -= n; width > 0; width--)
+        {
+            *p++ = ' ';
+        }
+        
+        while(n > 0)
+        {
+            *p++ = digits[--n];
+        }
+    }
+    
+    return p;
+}
+
+
+
+// Formats one association line - the word, numbered or not, its count and proportion - into
+// the screen Buffer, and copies it to the echo Buffer if there is one.  It's the old
+//
+//     "%4d: %s" or "      %s", then "%-25s %3d %5.2f\n" or "%s\t%d\t%.2f\n"
+//
+// with the -t and -n choices made at compile time - renderResult picks one of the four.
+//
+template <bool TABS, bool NUMBER> static void outLine(Buffer * screen, Buffer * echo, int n, const char * word, int wordLen, int count, float prop)
+{
+    char * line;
+    char * p;
+    char * label;
+    int    labelLen;
+    
+    bufReserve(screen, 96 + wordLen);
+    
+    line = p = screen->data + screen->len;
+    
+    if(NUMBER)
+    {
+        p = putInt(p, n, 4);
+        
+        *p++ = ':';
+        *p++ = ' ';
+    }
+    else
+    {
+        memcpy(p, "      ", 6);
+        
+        p += 6;
+    }
+    
+    label = line;
+    
+    memcpy(p, word, wordLen);
+    
+    p += wordLen;
+    
+    if(TABS)
+    {
+        *p++ = '\t';
+        
+        p = putInt(p, count, 0);
+        
+        *p++ = '\t';
+        
+        p = putProp(p, prop, 0);
+    }
+    else
+    {
+        for(labelLen = (int)(p - label); labelLen < 25; labelLen++)
+        {
+            *p++ = ' ';
+        }
+        
+        *p++ = ' ';
+        
+        p = putInt(p, count, 3);
+        
+        *p++ = ' ';
+        
+        p = putProp(p, prop, 5);
+    }
+    
+    *p++ = '\n';
+    
+    screen->len += p - line;
+    
+    if(echo != NULL)
+    {
+        bufAppend(echo, line, p - line);
+    }
+}
+
+
+
+// Writes a slot's two Buffers out, and empties them.
+//
+static void writeSlot(OutSlot * slot)
+{
+    int k;
+    
+    for(k = 0; k < 2; k++)
+    {
+        int          fd  = k == 0 ? 1 : slot->echoFd;
+        const char * p   = slot->out[k].data;
+        size_t       len = slot->out[k].len;
+        
+        while(fd >= 0 && len > 0)
+        {
+            long n = (long)write(fd, p, (unsigned int)len);
+            
+            if(n <= 0)
+            {
+                break;
+            }
+            
+            p   += n;
+            len -= n;
+        }
+        
+        slot->out[k].len = 0;
+    }
+}
+
+
+
+// The output writer's thread - writes each Buffer as it's handed over, with one write to
+// stdout and one to the echo file.
+//
+static void * runWriter(void * arg)
+{
+    (void)arg;
+    
+    pthread_mutex_lock(&writer.lock);
+    
+    for(;;)
+    {
+        OutSlot * slot;
+        
+        while(writer.written == writer.queued)
+        {
+            pthread_cond_wait(&writer.ready, &writer.lock);
+        }
+        
+        slot = &writer.slots[writer.written % OUTSLOTS];
+        
+        pthread_mutex_unlock(&writer.lock);
+        
+        writeSlot(slot);
+        
+        pthread_mutex_lock(&writer.lock);
+        
+        writer.written++;
+        
+        pthread_cond_broadcast(&writer.drained);
+    }
+    
+    return NULL;
+}
+
+
+
+// Hands the slot being filled to the writer, waiting if it's OUTSLOTS behind.  Anything
+// printf'd to stdout before is flushed first, so it isn't overtaken.
+//
+static void submitSlot(void)
+{
+    OutSlot * slot = &writer.slots[writer.queued % OUTSLOTS];
+    
+    if(slot->out[0].len == 0 && slot->out[1].len == 0)
+    {
+        return;
+    }
+    
+    fflush(stdout);
+
+#ifdef _WIN32
+    writeSlot(slot);
+#else
+    pthread_mutex_lock(&writer.lock);
+    
+    writer.queued++;
+    
+    pthread_cond_signal(&writer.ready);
+    
+    while(writer.queued - writer.written >= OUTSLOTS)
+    {
+        pthread_cond_wait(&writer.drained, &writer.lock);
+    }
+    
+    pthread_mutex_unlock(&writer.lock);
+#endif
+}
+
+
+
+// Sends everything emitted so far on its way, and waits until it's written - before anything
+// else goes to stdout, and at exit.
+//
+static void flushOutput(void)
+{
+    if(!writer.started)
+    {
+        return;
+    }
+    
+    submitSlot();
+    
+    pthread_mutex_lock(&writer.lock);
+    
+    while(writer.written != writer.queued)
+    {
+        pthread_cond_wait(&writer.drained, &writer.lock);
+    }
+    
+    pthread_mutex_unlock(&writer.lock);
+}
+
+
+
+// Queues a rendered result for output - the screen part for stdout and, if -f was used, the
+// echo part for the end of the echo file.  Results collect in an OUTCHUNK sized Buffer which
+// is handed whole to the writer thread, so a batch costs a write every OUTCHUNK bytes rather
+// than stdio's every few KB (and an fopen/fclose of the echo file for every word).
+//
+static void emit(const char * screen, size_t screenLen, const char * echo, size_t echoLen)
+{
+    OutSlot * slot;
+    
+    if(!writer.started)
+    {
+        int i;
+        
+        for(i = 0; i < OUTSLOTS; i++)
+        {
+            writer.slots[i].echoFd = -1;
+        }
+        
+        writer.echoFd = -1;
+        writer.started = true;
+        
+        pthread_mutex_init(&writer.lock, NULL);
+        pthread_cond_init(&writer.ready, NULL);
+        pthread_cond_init(&writer.drained, NULL);
+
+#ifndef _WIN32
+        pthread_create(&writer.thread, NULL, runWriter, NULL);
+#endif
+        
+        atexit(flushOutput);
+    }
+    
+    // A new -f file (an -i file's lines can each have their own) - finish with the old one.
+    //
+    if(echoFile == NULL ? writer.echoName != NULL : writer.echoName == NULL || strcmp(echoFile, writer.echoName))
+    {
+        flushOutput();
+        
+        if(writer.echoFd >= 0)
+        {
+            close(writer.echoFd);
+        }
+        
+        free(writer.echoName);
+        
+        writer.echoName = echoFile != NULL ? strdup(echoFile) : NULL;
+        writer.echoFd   = echoFile != NULL ? open(echoFile, O_WRONLY | O_CREAT | O_APPEND, 0666) : -1;
+    }
+    
+    slot = &writer.slots[writer.queued % OUTSLOTS];
+    
+    slot->echoFd = writer.echoFd;
+    
+    bufAppend(&slot->out[0], screen, screenLen);
+    
+    if(writer.echoFd >= 0)
+    {
+        bufAppend(&slot->out[1], echo, echoLen);
+    }
+    
+    if(slot->out[0].len + slot->out[1].len >= OUTCHUNK)
+    {
+        submitSlot();
+    }
+}
+
+
+
+// Appends to a Buffer as printf would.
+//
+static void bufPrintf(Buffer * buf, const char * format, ...)
+{
+    va_list args;
+    
+    int n;
+    
+    va_start(args, format);
+    
+    n = vsnprintf(buf->data + buf->len, buf->cap - buf->len, format, args);
+    
+    va_end(args);
+    
+    if(n >= 0 && buf->len + n >= buf->cap)
+    {
+        // Didn't fit - make room and do it again.
+        //
+        bufReserve(buf, n + 1);
+        
+        va_start(args, format);
+        
+        vsnprintf(buf->data + buf->len, buf->cap - buf->len, format, args);
+        
+        va_end(args);
+    }
+    
+    if(n > 0)
+    {
+        buf->len += n;
+    }
+    
+    return;
+}
+
+
+
+// The functionally 'main' routine - checks in the index/data files for relevant data and outputs it.
+//
+static void checkForWord(char * cue)
+{
+    static Buffer screen;                /* reused from one cue to the next         */
+    static Buffer echo;
+    
+    Layout layout = switchLayout();
+    
+    Tally before = tally;
+    
+    long long start;
+    
+    bool found;
+    
+    // Check that cue isn't either the 'toggle db' or 'dump index words' flags - which print
+    // straight to stdout (stderr with --format, so the records stay parseable), so what's been
+    // emitted goes first.
+    //
+    if(*cue == '-')
+    {
+        flushOutput();
+    }
+    
+    if(toggleDataBaseCheck(cue) || dumpWords(cue))
+    {
+        return;
+    }
+    
+    trimLF(cue);
+    
+    STRUPR(cue);
+
+    screen.len = 0;
+    echo.len   = 0;
+    
+    start = traceFile != NULL ? nowNs() : 0;
+    
+    if(graphQuery != 0)
+    {
+        found = renderGraph(engine.cur->mode, cue, &layout, &screen, &echo);
+    }
+    else
+    {
+        found = renderCue(engine.cur, cue, &layout, &screen, &echo);
+    }
+    
+    if(traceFile != NULL)
+    {
+        traceQuery(cue, engine.cur->mode, &layout, found, start, nowNs());
+    }
+    
+    emit(screen.data, screen.len, echo.data, echo.len);
+    
+    if(statsMode != 0)
+    {
+        statsCue(cue, engine.cur->mode, &before);
+    }
+    
+    return;
+}
+
+
+
+// The Layout the -t, -n, -d and -l switches (and --format) currently ask for.
+//
+static Layout switchLayout(void)
+{
+    Layout layout;
+    
+    layout.tabs    = bTabPad;
+    layout.number  = bNumber;
+    layout.demark  = bDemark;
+    layout.limited = bLimit;
+    layout.limit   = nLimit;
+    layout.format  = outFormat;
+    
+    return layout;
+}
+
+
+
+// Formats everything that's output for one cue: the 'Looking for' line and then either the
+// associations and totals from its index entry, or the reason there aren't any (entry is NULL
+// if cue isn't a headword).  The association lines also go to 'echo', unless that's NULL.
+//
+static void renderResult(Dataset * ds, const char * cue, const IndexEntry * entry, const Layout * layout, Buffer * screen, Buffer * echo)
+{
+    int count;
+    int tot_rec  = 0;
+    int tot_freq = 0;
+    
+    float prop   = 0;
+    
+	long int tail_address = 0;
+
+    const char * word;
+    
+    int wordLen;
+
+    AssocCursor assoc;
+    
+    ArenaMark mark = arenaMark();        /* what the cursor takes is given back at the end */
+    
+    long long t;
+    
+    // The -t and -n choices are compiled into each of these.
+    //
+    void (* line)(Buffer *, Buffer *, int, const char *, int, int, float) =
+        layout->tabs ? (layout->number ? outLine<true, true> : outLine<true, false>) : (layout->number ? outLine<false, true> : outLine<false, false>);
+    
+    if(layout->format != FORMAT_TEXT)
+    {
+        renderRecord(ds, cue, entry, layout, screen, echo);
+        
+        arenaRelease(mark);
+        
+        return;
+    }
+    
+    t = statsMode != 0 ? nowNs() : 0;
+
+    bufPrintf(screen, "\nLooking for: %s in %s MODE\n\n", cue, ds->mode == 'r' ? "RESPONSE" : "STIMULUS");
+    
+    if(entry != NULL)
+    {
+        tot_rec      = entry->tot_rec;
+        tot_freq     = entry->tot_freq;
+        tail_address = entry->tail_address;
+        
+        tally.found++;
+    }
+
+    if(entry == NULL)
+    {
+        bufPrintf(screen, "eatshow: %s: not found\n", cue);
+    }
+    else // We found 'cue' - w00t!
+    {
+        tally.formatNs += lap(&t);
+        
+        if(openAssoc(ds, entry, &assoc))
+        {
+            int nCount = 0;
+            
+            tally.seekNs += lap(&t);
+            
+            if(layout->demark)
+            {
+                bufPrintf(screen, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
+            }
+            
+            while(nextAssoc(&assoc, &word, &wordLen, &count))
+            {
+                tally.tokenizeNs += lap(&t);
+                
+                // Limit the output to nLimit entries?
+                //
+                if(layout->limited)
+                {
+                    if(nCount >= layout->limit)
+                    {
+                        break;
+                    }
+                }
+            
+                // Number the outputs?  (Only numbered ones have a proportion - as ever.)
+                //
+                if(layout->number)
+                {
+                    ++nCount;
+                    
+                    prop = ((float) count / (float) tot_freq);
+                }
+                
+                line(screen, echo, nCount, word, wordLen, count, prop);
+                
+                tally.records++;
+                tally.formatNs += lap(&t);
+            }
+            
+            tally.tokenizeNs += lap(&t);
+            
+            if(layout->demark)
+            {
+                bufPrintf(screen, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
+            }
+
+            bufPrintf(screen, "\n\t%s %s\n\n", cue, ds->mode == 'r' ? "was [one of] the 'response(s)' to the stimulli above" : "was [one of] the 'stimuli' to the responses above");
+                
+            bufPrintf(screen, "\tNumber of different answers: %d\n", tot_rec);
+            
+            bufPrintf(screen, "\t Total count of all answers: %d\n\n", tot_freq);
+        }
+        else
+        {
+            bufPrintf(screen, "eatshow: %ld: bad address index file\n", tail_address);
+        }
+    }
+    
+    arenaRelease(mark);
+    
+    tally.formatNs += lap(&t);
+    
+    return;
+}
+
+
+
+// Appends a word as a JSON string - escaped, and with any byte over 127 taken as Latin-1.
+//
+static void bufJson(Buffer * buf, const char * s, int len)
+{
+    int i;
+    
+    bufReserve(buf, 6 * len + 2);
+    
+    buf->data[buf->len++] = '"';
+    
+    for(i = 0; i < len; i++)
+    {
+        unsigned char c = (unsigned char)s[i];
+        
+        if(c == '"' || c == '\\')
+        {
+            buf->data[buf->len++] = '\\';
+            buf->data[buf->len++] = (char)c;
+        }
+        else if(c < ' ')
+        {
+            buf->len += sprintf(buf->data + buf->len, "\\u%04x", c);
+        }
+        else if(c > 127)
+        {
+            buf->data[buf->len++] = (char)(0xC0 | c >> 6);
+            buf->data[buf->len++] = (char)(0x80 | (c & 0x3F));
+        }
+        else
+        {
+            buf->data[buf->len++] = (char)c;
+        }
+    }
+    
+    buf->data[buf->len++] = '"';
+}
+
+
+
+// Appends a CSV field - quoted (and its quotes doubled) only if it has to be.
+//
+static void bufCsv(Buffer * buf, const char * s, int len)
+{
+    int i;
+    
+    if(len > 0 && strcspn(s, ",\"\r\n") >= (size_t)len && s[0] != ' ' && s[len - 1] != ' ')
+    {
+        bufAppend(buf, s, len);
+        
+        return;
+    }
+    
+    bufAppend(buf, "\"", 1);
+    
+    for(i = 0; i < len; i++)
+    {
+        bufAppend(buf, s[i] == '"' ? "\"\"" : s + i, s[i] == '"' ? 2 : 1);
+    }
+    
+    bufAppend(buf, "\"", 1);
+}
+
+
+
+// What starts --format's output, before any cue's - the CSV header line, or the binary
+// format's ColumnHeader.  Written once, however often main is entered.
+//
+static void startFormat(void)
+{
+    static bool started = false;
+    
+    if(started)
+    {
+        return;
+    }
+    
+    started = true;
+    
+    if(outFormat == FORMAT_CSV && graphQuery == GRAPH_EXPAND)
+    {
+        static const char header[] = "cue,direction,found,rank,word,hops,score,via\n";
+        
+        emit(header, sizeof(header) - 1, header, sizeof(header) - 1);
+    }
+    else if(outFormat == FORMAT_CSV && graphQuery == GRAPH_SIMILAR)
+    {
+        static const char header[] = "cue,direction,found,metric,rank,word,score,shared\n";
+        
+        emit(header, sizeof(header) - 1, header, sizeof(header) - 1);
+    }
+    else if(outFormat == FORMAT_CSV && graphQuery == GRAPH_ACTIVATE)
+    {
+        static const char header[] = "cue,direction,found,rank,word,score\n";
+        
+        emit(header, sizeof(header) - 1, header, sizeof(header) - 1);
+    }
+    else if(outFormat == FORMAT_CSV && graphQuery == GRAPH_PATH)
+    {
+        static const char header[] = "from,to,direction,found,expanded,step,word,count,proportion\n";
+        
+        emit(header, sizeof(header) - 1, header, sizeof(header) - 1);
+    }
+    else if(outFormat == FORMAT_CSV)
+    {
+        static const char header[] = "cue,direction,found,tot_rec,tot_freq,rank,associate,count,proportion\n";
+        
+        emit(header, sizeof(header) - 1, header, sizeof(header) - 1);
+    }
+    else if(outFormat == FORMAT_BIN)
+    {
+        ColumnHeader h;
+        
+        memset(&h, 0, sizeof(h));
+        
+        memcpy(h.magic, "EATCOLS", 8);
+        
+        h.version   = COLUMNVERSION;
+        h.byteOrder = 0x01020304;
+        
+        emit((const char *)&h, sizeof(h), (const char *)&h, sizeof(h));
+    }
+}
+
+
+
+// renderResult for --format's jsonl, csv and bin: the cue, its direction, tot_rec, tot_freq and
+// the (limited) list of associates, counts and proportions - and nothing else.  The same goes
+// to 'echo' if there is one.  See the README for the layouts.
+//
+static void renderRecord(Dataset * ds, const char * cue, const IndexEntry * entry, const Layout * layout, Buffer * screen, Buffer * echo)
+{
+    // The binary format's columns are gathered here, and then appended whole.
+    //
+    static thread_local Buffer columns[4];
+    
+    const char * direction = ds->mode == 'r' ? "r-s" : "s-r";
+    size_t       start     = screen->len;
+    int          cueLen    = (int)strlen(cue);
+    int          n         = 0;
+    int          count;
+    int          wordLen;
+    const char * word;
+    
+    AssocCursor assoc;
+    ColumnBlock block;
+    
+    long long t = statsMode != 0 ? nowNs() : 0;
+    
+    bool open = entry != NULL && openAssoc(ds, entry, &assoc);
+    
+    tally.seekNs += lap(&t);
+    
+    if(entry != NULL)
+    {
+        tally.found++;
+    }
+    
+    if(layout->format == FORMAT_JSONL)
+    {
+        bufAppend(screen, "{\"cue\":", 7);
+        bufJson(screen, cue, cueLen);
+        bufPrintf(screen, ",\"direction\":\"%s\",\"found\":%s", direction, entry != NULL ? "true" : "false");
+        
+        if(entry != NULL)
+        {
+            bufPrintf(screen, ",\"tot_rec\":%d,\"tot_freq\":%d,\"associations\":[", entry->tot_rec, entry->tot_freq);
+        }
+    }
+    else if(layout->format == FORMAT_CSV && entry == NULL)
+    {
+        bufCsv(screen, cue, cueLen);
+        bufPrintf(screen, ",%s,0,,,,,,\n", direction);
+    }
+    else if(layout->format == FORMAT_BIN)
+    {
+        columns[0].len = columns[1].len = columns[2].len = columns[3].len = 0;
+    }
+    
+    while(open && (!layout->limited || n < layout->limit) && nextAssoc(&assoc, &word, &wordLen, &count))
+    {
+        double prop = entry->tot_freq != 0 ? (double)count / entry->tot_freq : 0;
+        
+        tally.tokenizeNs += lap(&t);
+        
+        n++;
+        
+        if(layout->format == FORMAT_JSONL)
+        {
+            bufAppend(screen, n > 1 ? ",{\"word\":" : "{\"word\":", n > 1 ? 9 : 8);
+            bufJson(screen, word, wordLen);
+            bufPrintf(screen, ",\"count\":%d,\"proportion\":%.6g}", count, prop);
+        }
+        else if(layout->format == FORMAT_CSV)
+        {
+            bufCsv(screen, cue, cueLen);
+            bufPrintf(screen, ",%s,1,%d,%d,%d,", direction, entry->tot_rec, entry->tot_freq, n);
+            bufCsv(screen, word, wordLen);
+            bufPrintf(screen, ",%d,%.6g\n", count, prop);
+        }
+        else
+        {
+            float        p = (float)prop;
+            unsigned int end;
+            
+            bufAppend(&columns[3], word, wordLen);
+            
+            end = (unsigned int)columns[3].len;
+            
+            bufAppend(&columns[0], &count, sizeof(count));
+            bufAppend(&columns[1], &p, sizeof(p));
+            bufAppend(&columns[2], &end, sizeof(end));
+        }
+        
+        tally.records++;
+        tally.formatNs += lap(&t);
+    }
+    
+    if(layout->format == FORMAT_JSONL)
+    {
+        bufAppend(screen, entry != NULL ? "]}\n" : "}\n", entry != NULL ? 3 : 2);
+    }
+    else if(layout->format == FORMAT_CSV && entry != NULL && n == 0)
+    {
+        bufCsv(screen, cue, cueLen);
+        bufPrintf(screen, ",%s,1,%d,%d,,,,\n", direction, entry->tot_rec, entry->tot_freq);
+    }
+    else if(layout->format == FORMAT_BIN)
+    {
+        static const char zeros[4] = { 0, 0, 0, 0 };
+        
+        memset(&block, 0, sizeof(block));
+        
+        block.flags    = (entry != NULL ? COLUMN_FOUND : 0) | (ds->mode == 'r' ? COLUMN_RS : 0);
+        block.tot_rec  = entry != NULL ? entry->tot_rec : 0;
+        block.tot_freq = entry != NULL ? entry->tot_freq : 0;
+        block.n        = (unsigned int)n;
+        block.cueLen   = (unsigned int)cueLen;
+        block.wordsLen = (unsigned int)columns[3].len;
+        block.size     = (unsigned int)(sizeof(block) - sizeof(block.size) + ((cueLen + 3) & ~3) + 3 * n * 4 + ((columns[3].len + 3) & ~3));
+        
+        bufAppend(screen, &block, sizeof(block));
+        bufAppend(screen, cue, cueLen);
+        bufAppend(screen, zeros, -cueLen & 3);
+        bufAppend(screen, columns[0].data, columns[0].len);
+        bufAppend(screen, columns[1].data, columns[1].len);
+        bufAppend(screen, columns[2].data, columns[2].len);
+        bufAppend(screen, columns[3].data, columns[3].len);
+        bufAppend(screen, zeros, -(int)columns[3].len & 3);
+    }
+    
+    if(echo != NULL)
+    {
+        bufAppend(echo, screen->data + start, screen->len - start);
+    }
+    
+    tally.formatNs += lap(&t);
+}
+
+
+
+// Sets up the result cache - -c<kb> of it, or CACHEKB unless -m's asked for bounded memory.
+//
+static void initCache(void)
+{
+    long kb = nCache >= 0 ? nCache : nBudget > 0 ? 0 : CACHEKB;
+    int  i;
+    
+    cacheBudget = (size_t)kb * 1024 / CACHESHARDS;
+    
+    for(i = 0; i < CACHESHARDS && cacheBudget > 0; i++)
+    {
+        pthread_mutex_init(&resultCache[i].lock, NULL);
+        
+        if((resultCache[i].chains = (CacheEntry **)calloc(CACHECHAINS, sizeof(CacheEntry *))) == NULL)
+        {
+            fprintf(stderr, "eatshow: out of memory\n");
+            
+            exit(1);
+        }
+    }
+}
+
+
+
+static bool sameLayout(const Layout * a, const Layout * b)
+{
+    return a->tabs == b->tabs && a->number == b->number && a->demark == b->demark && a->limited == b->limited && (!a->limited || a->limit == b->limit) && a->format == b->format;
+}
+
+
+
+// Finds a cache entry in a shard (whose lock is held).
+//
+static CacheEntry * cacheFind(const CacheShard * shard, unsigned long long hash, char mode, const char * cue, const Layout * layout)
+{
+    CacheEntry * e;
+    
+    for(e = shard->chains[(hash / CACHESHARDS) % CACHECHAINS]; e != NULL; e = e->next)
+    {
+        if(e->hash == hash && e->mode == mode && sameLayout(&e->layout, layout) && !strcmp(e->cue, cue))
+        {
+            return e;
+        }
+    }
+    
+    return NULL;
+}
+
+
+
+// Adds a rendered result to a shard (whose lock is held), first evicting as much as it takes
+// to keep the shard inside its budget.
+//
+static void cacheAdd(CacheShard * shard, unsigned long long hash, char mode, const char * cue, const Layout * layout, bool found, const Buffer * screen, const Buffer * echo)
+{
+    size_t       cueLen = strlen(cue);
+    size_t       size   = sizeof(CacheEntry) + cueLen + screen->len + echo->len;
+    CacheEntry * e;
+    CacheEntry ** chain;
+    
+    if(size > cacheBudget || cacheFind(shard, hash, mode, cue, layout) != NULL)
+    {
+        return;
+    }
+    
+    while(shard->bytes + size > cacheBudget && shard->nslots > 0)
+    {
+        if(shard->hand >= shard->nslots)
+        {
+            shard->hand = 0;
+        }
+        
+        e = shard->slots[shard->hand];
+        
+        if(e->ref)
+        {
+            e->ref = false;
+            
+            shard->hand++;
+            
+            continue;
+        }
+        
+        for(chain = &shard->chains[(e->hash / CACHESHARDS) % CACHECHAINS]; *chain != e; chain = &(*chain)->next)
+        {
+        }
+        
+        *chain = e->next;
+        
+        // The last slot's entry fills the gap.
+        //
+        shard->slots[shard->hand] = shard->slots[--shard->nslots];
+        
+        shard->slots[shard->hand]->slot = shard->hand;
+        
+        shard->bytes -= e->size;
+        
+        shard->evictions++;
+        
+        free(e);
+    }
+    
+    if(shard->nslots == shard->cap)
+    {
+        shard->cap = shard->cap == 0 ? 256 : shard->cap * 2;
+        
+        if((shard->slots = (CacheEntry **)realloc(shard->slots, shard->cap * sizeof(CacheEntry *))) == NULL)
+        {
+            fprintf(stderr, "eatshow: out of memory\n");
+            
+            exit(1);
+        }
+    }
+    
+    if((e = (CacheEntry *)malloc(size)) == NULL)
+    {
+        return;
+    }
+    
+    e->hash      = hash;
+    e->mode      = mode;
+    e->layout    = *layout;
+    e->found     = found;
+    e->ref       = false;
+    e->size      = size;
+    e->screenLen = screen->len;
+    e->echoLen   = echo->len;
+    
+    memcpy(e->cue, cue, cueLen + 1);
+    memcpy(e->cue + cueLen + 1, screen->data, screen->len);
+    memcpy(e->cue + cueLen + 1 + screen->len, echo->data, echo->len);
+    
+    chain = &shard->chains[(hash / CACHESHARDS) % CACHECHAINS];
+    
+    e->next = *chain;
+    *chain  = e;
+    
+    e->slot = shard->nslots;
+    
+    shard->slots[shard->nslots++] = e;
+    
+    shard->bytes += size;
+}
+
+
+
+// Renders a cue, as renderResult would, into 'screen' and 'echo' (which are added to) - copied
+// straight from the result cache if it's been rendered the same way before, and cached if not.
+// Any number of threads can use the cache at once.
+//
+// Returns: whether cue is a headword.
+//
+static bool renderCue(Dataset * ds, const char * cue, const Layout * layout, Buffer * screen, Buffer * echo)
+{
+    const IndexEntry * entry;
+    CacheShard       * shard;
+    CacheEntry       * e;
+    
+    unsigned long long hash;
+    
+    size_t screenAt = screen->len;
+    size_t echoAt   = echo->len;
+    
+    long long t = statsMode != 0 ? nowNs() : 0;
+    
+    if(cacheBudget == 0)
+    {
+        entry = findCue(ds, cue);
+        
+        tally.indexNs += lap(&t);
+        
+        renderResult(ds, cue, entry, layout, screen, echo);
+        
+        return entry != NULL;
+    }
+    
+    hash  = hashKey(cue, (layout->tabs | layout->number << 1 | layout->demark << 2 | layout->limited << 3) + (ds->mode << 4) + (layout->limited ? (unsigned int)layout->limit << 12 : 0));
+    shard = &resultCache[hash % CACHESHARDS];
+    
+    pthread_mutex_lock(&shard->lock);
+    
+    if((e = cacheFind(shard, hash, ds->mode, cue, layout)) != NULL)
+    {
+        bool found = e->found;
+        
+        const char * text = e->cue + strlen(e->cue) + 1;
+        
+        e->ref = true;
+        
+        shard->hits++;
+        
+        bufAppend(screen, text, e->screenLen);
+        bufAppend(echo, text + e->screenLen, e->echoLen);
+        
+        pthread_mutex_unlock(&shard->lock);
+        
+        tally.formatNs += lap(&t);
+        tally.found    += found;
+        tally.cached++;
+        
+        return found;
+    }
+    
+    shard->misses++;
+    
+    pthread_mutex_unlock(&shard->lock);
+    
+    // Rendered outside the lock, as another thread may be doing the same - whichever gets
+    // back first adds it.
+    //
+    entry = findCue(ds, cue);
+    
+    tally.indexNs += lap(&t);
+    
+    renderResult(ds, cue, entry, layout, screen, echo);
+    
+    {
+        Buffer s;
+        Buffer t;
+        
+        s.data = screen->data + screenAt;
+        s.len  = screen->len - screenAt;
+        t.data = echo->data + echoAt;
+        t.len  = echo->len - echoAt;
+        
+        pthread_mutex_lock(&shard->lock);
+        
+        cacheAdd(shard, hash, ds->mode, cue, layout, entry != NULL, &s, &t);
+        
+        pthread_mutex_unlock(&shard->lock);
+    }
+    
+    return entry != NULL;
+}
+
+
+
+// Adds up the result cache's counters over all its shards.
+//
+static void cacheCounters(unsigned long * hits, unsigned long * misses, unsigned long * evictions, unsigned long * bytes, long * entries)
+{
+    int i;
+    
+    for(i = 0; i < CACHESHARDS && cacheBudget > 0; i++)
+    {
+        pthread_mutex_lock(&resultCache[i].lock);
+        
+        *hits      += resultCache[i].hits;
+        *misses    += resultCache[i].misses;
+        *evictions += resultCache[i].evictions;
+        *bytes     += resultCache[i].bytes;
+        *entries   += resultCache[i].nslots;
+        
+        pthread_mutex_unlock(&resultCache[i].lock);
+    }
+}
+
+
+
+// Throws away everything in the result cache (its counters carry on).
+//
+static void emptyCache(void)
+{
+    int i;
+    
+    for(i = 0; i < CACHESHARDS && cacheBudget > 0; i++)
+    {
+        CacheShard * shard = &resultCache[i];
+        
+        long k;
+        
+        pthread_mutex_lock(&shard->lock);
+        
+        for(k = 0; k < shard->nslots; k++)
+        {
+            free(shard->slots[k]);
+        }
+        
+        memset(shard->chains, 0, CACHECHAINS * sizeof(CacheEntry *));
+        
+        shard->nslots = 0;
+        shard->hand   = 0;
+        shard->bytes  = 0;
+        
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+
+
+// One distinct cue of a -b batch.
+//
+typedef struct
+{
+    size_t             cue;              /* offset of the cue in the batch's text                 */
+    IndexEntry         entry;            /* its index entry, if 'found'                           */
+    bool               found;
+    long               chunk;            /* the BatchChunk its output is in                       */
+    size_t             screen;           /* where its output is in that chunk's Buffer            */
+    size_t             screenLen;
+    size_t             echo;
+    size_t             echoLen;
+} BatchItem;
+
+// A run of a batch's items (in data file order) rendered together, by one thread, into one
+// Buffer - which isn't touched again once 'ready' is set.
+//
+typedef struct
+{
+    Buffer out;
+    bool   ready;
+} BatchChunk;
+
+// What the threads rendering a batch share.  Chunks are handed out in order, under 'lock';
+// 'done' is signalled whenever one is finished.
+//
+typedef struct
+{
+    Dataset         * ds;
+    const char      * text;
+    BatchItem      ** byAddr;
+    long              nitems;
+    Layout            layout;
+    BatchChunk      * chunks;
+    long              nchunks;
+    long              next;
+    pthread_mutex_t   lock;
+    pthread_cond_t    done;
+} BatchWork;
+
+static const long BATCHCHUNK = 64;       /* items rendered per BatchChunk                         */
+
+static const char   * batchText;         /* the batch's cues, and where each line's is - */
+static const size_t * batchCues;         /* for the comparators                           */
+
+// Orders batch lines (given as line numbers) by their cues.
+//
+static int compareLines(const void * a, const void * b)
+{
+    return strcmp(batchText + batchCues[*(const long *)a], batchText + batchCues[*(const long *)b]);
+}
+
+// Orders index entries (given as pointers) by key.
+//
+static int compareKeys(const void * a, const void * b)
+{
+    return strcmp((*(const IndexEntry * const *)a)->key, (*(const IndexEntry * const *)b)->key);
+}
+
+// Orders batch items by where their association lists are in the data file.
+//
+static int compareAddresses(const void * a, const void * b)
+{
+    const BatchItem * x = *(const BatchItem * const *)a;
+    const BatchItem * y = *(const BatchItem * const *)b;
+    
+    if(x->found != y->found)
+    {
+        return x->found ? -1 : 1;
+    }
+    
+    return x->entry.tail_address < y->entry.tail_address ? -1 : x->entry.tail_address > y->entry.tail_address ? 1 : 0;
+}
+
+
+
+// Renders chunks of a batch until there are none left.  Any number of these can run at once
+// (the dataset is only read) - see runBatch.
+//
+static void * renderChunks(void * arg)
+{
+    BatchWork * work = (BatchWork *)arg;
+    
+    Buffer echo;
+    
+    memset(&echo, 0, sizeof(echo));
+    
+    for(;;)
+    {
+        BatchChunk * chunk;
+        
+        long c;
+        long i;
+        
+        pthread_mutex_lock(&work->lock);
+        
+        c = work->next++;
+        
+        pthread_mutex_unlock(&work->lock);
+        
+        if(c >= work->nchunks)
+        {
+            break;
+        }
+        
+        chunk = &work->chunks[c];
+        
+        for(i = c * BATCHCHUNK; i < work->nitems && i < (c + 1) * BATCHCHUNK; i++)
+        {
+            BatchItem * it = work->byAddr[i];
+            
+            Tally before = tally;
+            
+            long long start = traceFile != NULL ? nowNs() : 0;
+            
+            bool found = it->found;
+            
+            echo.len = 0;
+            
+            it->screen = chunk->out.len;
+            
+            if(graphQuery != 0)
+            {
+                found = renderGraph(work->ds->mode, work->text + it->cue, &work->layout, &chunk->out, echoFile != NULL ? &echo : NULL);
+            }
+            else
+            {
+                renderResult(work->ds, work->text + it->cue, it->found ? &it->entry : NULL, &work->layout, &chunk->out, echoFile != NULL ? &echo : NULL);
+            }
+            
+            if(traceFile != NULL)
+            {
+                traceQuery(work->text + it->cue, work->ds->mode, &work->layout, found, start, nowNs());
+            }
+            
+            if(statsMode != 0)
+            {
+                statsCue(work->text + it->cue, work->ds->mode, &before);
+            }
+            
+            it->screenLen = chunk->out.len - it->screen;
+            it->echo      = chunk->out.len;
+            it->echoLen   = echo.len;
+            
+            bufAppend(&chunk->out, echo.data, echo.len);
+        }
+        
+        pthread_mutex_lock(&work->lock);
+        
+        chunk->ready = true;
+        
+        pthread_cond_broadcast(&work->done);
+        
+        pthread_mutex_unlock(&work->lock);
+    }
+    
+    free(echo.data);
+    
+    return NULL;
+}
+
+
+
+// One of runBatch's -j threads - renders chunks, then frees what its queries kept.
+//
+static void * renderThread(void * arg)
+{
+    bBatchThread = true;
+    
+    renderChunks(arg);
+    
+    arenaFree();
+    freeWalk();
+    
+    return NULL;
+}
+
+
+
+// Looks up a whole word list (-b<file>, one word per line) in the current mode.  Rather than
+// treat each word on its own, the list is sorted and de-duplicated, joined against the index
+// in a single pass, and the association lists fetched in the order they are in the data file.
+// The output is then written in the list's own order, exactly as if the words had been given
+// on the command line.
+//
+// With -j<n>, n threads render the distinct cues while this one writes each line's output as
+// soon as it's ready.
+//
+static void runBatch(const char * file)
+{
+    Dataset * ds = engine.cur;
+    
+    Buffer text;
+    
+    BatchWork work;
+    
+    Tally before;
+    
+    long long t;
+    
+    pthread_t * threads = NULL;
+    
+    size_t     * cues   = NULL;          /* every line's cue, in the list's order        */
+    long       * sorted = NULL;          /* line numbers, in cue order                   */
+    int        * itemOf = NULL;          /* which BatchItem each line's cue is           */
+    BatchItem  * items  = NULL;
+    BatchItem ** byAddr = NULL;
+    
+    long ncues  = 0;
+    long ncap   = 0;
+    long nitems = 0;
+    long i;
+    long j;
+    
+    char * line;
+    FILE * in;
+    
+    ArenaMark mark = arenaMark();
+    
+    if((in = fopen(file, "r")) == NULL)
+    {
+        printf("Error opening %s\n", file);
+        
+        return;
+    }
+    
+    memset(&text, 0, sizeof(text));
+    
+    // Each line's given back to the arena once it's copied into text.
+    //
+    for(; (line = readLine(in)) != NULL; arenaRelease(mark))
+    {
+        trimLF(line);
+        
+        if(nothingEntered(line))
+        {
+            continue;
+        }
+        
+        STRUPR(line);
+        
+        if(ncues == ncap)
+        {
+            ncap = ncap == 0 ? 1024 : ncap * 2;
+            
+            if((cues = (size_t *)realloc(cues, ncap * sizeof(size_t))) == NULL)
+            {
+                fprintf(stderr, "eatshow: out of memory\n");
+                
+                exit(1);
+            }
+        }
+        
+        cues[ncues++] = text.len;
+        
+        bufAppend(&text, line, strlen(line) + 1);
+    }
+    
+    fclose(in);
+    
+    if(ncues == 0)
+    {
+        return;
+    }
+    
+    batchText = text.data;
+    batchCues = cues;
+    
+    // Sort and de-duplicate.
+    //
+    sorted = (long *)malloc(ncues * sizeof(long));
+    itemOf = (int *)malloc(ncues * sizeof(int));
+    items  = (BatchItem *)calloc(ncues, sizeof(BatchItem));
+    byAddr = (BatchItem **)malloc(ncues * sizeof(BatchItem *));
+    
+    if(sorted == NULL || itemOf == NULL || items == NULL || byAddr == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    for(i = 0; i < ncues; i++)
+    {
+        sorted[i] = i;
+    }
+    
+    qsort(sorted, ncues, sizeof(long), compareLines);
+    
+    for(i = 0; i < ncues; i++)
+    {
+        if(nitems == 0 || strcmp(text.data + items[nitems - 1].cue, text.data + cues[sorted[i]]) != 0)
+        {
+            items[nitems++].cue = cues[sorted[i]];
+        }
+        
+        itemOf[sorted[i]] = (int)(nitems - 1);
+    }
+    
+    // Join the cues with the index.
+    //
+    before = tally;
+    
+    t = statsMode != 0 ? nowNs() : 0;
+    
+    if(ds->paged)
+    {
+        // The index file isn't in key order, so read it through once and binary search each
+        // of its keys in the (sorted) cues.  The first line with a key is the one used.
+        //
+        PagedIndex * pi = &ds->pindex;
+        
+        long pos = 0;
+        
+        bufferPool.queries += ncues;
+        
+        while(pos < pi->end)
+        {
+            char       window[512];
+            long       n = pagedRead(&pi->file, pos, window, sizeof(window));
+            long       lo = 0;
+            long       hi = nitems;
+            IndexEntry e;
+            
+            pos += parseIndexLine(window, window + n, &e);
+            
+            while(lo < hi)
+            {
+                long mid = (lo + hi) / 2;
+                
+                if(strcmp(text.data + items[mid].cue, e.key) < 0)
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+            
+            if(lo < nitems && !items[lo].found && strcmp(text.data + items[lo].cue, e.key) == WORD_FOUND)
+            {
+                items[lo].entry = e;
+                items[lo].found = true;
+            }
+        }
+    }
+    else
+    {
+        // Merge the sorted cues with the index's keys, sorted.
+        //
+        const HeadwordIndex * idx  = &ds->index;
+        const IndexEntry   ** keys = (const IndexEntry **)malloc((idx->nkeys + 1) * sizeof(IndexEntry *));
+        
+        for(j = 0; j < idx->nkeys; j++)
+        {
+            keys[j] = &idx->table[j];
+        }
+        
+        qsort(keys, idx->nkeys, sizeof(IndexEntry *), compareKeys);
+        
+        for(i = 0, j = 0; i < nitems && j < idx->nkeys; )
+        {
+            int cmp = strcmp(text.data + items[i].cue, keys[j]->key);
+            
+            tally.indexLines++;
+            
+            if(cmp == 0)
+            {
+                items[i].entry = *keys[j];
+                items[i].found = true;
+            }
+            
+            if(cmp <= 0)
+            {
+                i++;
+            }
+            else
+            {
+                j++;
+            }
+        }
+        
+        free(keys);
+    }
+    
+    tally.indexNs += lap(&t);
+    
+    if(statsMode != 0)
+    {
+        Tally join;
+        
+        tallySub(&join, &tally, &before);
+        
+        statsAdd(&join);
+    }
+    
+    // Render each distinct cue, visiting the data file in order.
+    //
+    for(i = 0; i < nitems; i++)
+    {
+        byAddr[i] = &items[i];
+    }
+    
+    qsort(byAddr, nitems, sizeof(BatchItem *), compareAddresses);
+    
+    for(i = 0; i < nitems; i++)
+    {
+        byAddr[i]->chunk = i / BATCHCHUNK;
+    }
+    
+    memset(&work, 0, sizeof(work));
+    
+    work.ds      = ds;
+    work.text    = text.data;
+    work.byAddr  = byAddr;
+    work.nitems  = nitems;
+    work.layout  = switchLayout();
+    work.nchunks = (nitems + BATCHCHUNK - 1) / BATCHCHUNK;
+    work.chunks  = (BatchChunk *)calloc(work.nchunks, sizeof(BatchChunk));
+    
+    pthread_mutex_init(&work.lock, NULL);
+    pthread_cond_init(&work.done, NULL);
+    
+    // Paged datasets share one buffer pool, so they're rendered here.
+    //
+    if(nThreads > 1 && !ds->paged)
+    {
+        threads = (pthread_t *)malloc(nThreads * sizeof(pthread_t));
+        
+        for(i = 0; i < nThreads; i++)
+        {
+            pthread_create(&threads[i], NULL, renderThread, &work);
+        }
+    }
+    else
+    {
+        renderChunks(&work);
+    }
+    
+    // And out, in the list's order.
+    //
+    for(i = 0; i < ncues; i++)
+    {
+        const BatchItem  * it = &items[itemOf[i]];
+        const BatchChunk * chunk;
+        
+        pthread_mutex_lock(&work.lock);
+        
+        while(!work.chunks[it->chunk].ready)
+        {
+            pthread_cond_wait(&work.done, &work.lock);
+        }
+        
+        pthread_mutex_unlock(&work.lock);
+        
+        chunk = &work.chunks[it->chunk];
+        
+        emit(chunk->out.data + it->screen, it->screenLen, chunk->out.data + it->echo, it->echoLen);
+    }
+    
+    if(threads != NULL)
+    {
+        for(i = 0; i < nThreads; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+        
+        free(threads);
+    }
+    
+    for(i = 0; i < work.nchunks; i++)
+    {
+        free(work.chunks[i].out.data);
+    }
+    
+    free(work.chunks);
+    
+    pthread_cond_destroy(&work.done);
+    pthread_mutex_destroy(&work.lock);
+    
+    free(byAddr);
+    free(items);
+    free(itemOf);
+    free(sorted);
+    free(cues);
+    free(text.data);
+    
+    return;
+}
+
+
+
+// --pipe: the largest frame or line accepted, and how much output is held back before it's
+// written anyway.
+//
+static const long PIPEFRAME = 16384;
+static const long PIPEFLUSH = 65536;
+
+// Appends a 32 bit value, least significant byte first, for --pipe bin's frames.
+//
+static void put32(Buffer * buf, unsigned long v)
+{
+    unsigned char b[4];
+    
+    b[0] = (unsigned char)v;
+    b[1] = (unsigned char)(v >> 8);
+    b[2] = (unsigned char)(v >> 16);
+    b[3] = (unsigned char)(v >> 24);
+    
+    bufAppend(buf, b, 4);
+}
+
+static unsigned long get32(const char * p)
+{
+    const unsigned char * b = (const unsigned char *)p;
+    
+    return b[0] | (unsigned long)b[1] << 8 | (unsigned long)b[2] << 16 | (unsigned long)b[3] << 24;
+}
+
+
+
+// Writes all of a Buffer to a file descriptor and empties it.
+//
+static void flushFd(int fd, Buffer * buf)
+{
+    size_t done = 0;
+    
+    while(done < buf->len)
+    {
+        long n = (long)write(fd, buf->data + done, buf->len - done);
+        
+        if(n <= 0)
+        {
+            exit(1);
+        }
+        
+        done += n;
+    }
+    
+    buf->len = 0;
+}
+
+
+
+// Answers one --pipe request.  Status is 0 (found), 1 (not found) or 2 (an error, with 'why').
+//
+// Tab-separated, the answer is a line of 'id status', then - when found - 'types answers n'
+// on the same line, followed by n lines of 'word count'.
+//
+// Binary, it's one frame: its length, then id, status, types, answers and n, then n
+// (length, word, count) triples - all lengths and numbers being 32 bit little-endian.
+//
+static void answerPipe(Buffer * out, bool binary, unsigned long id, char mode, int limit, char * cue, const char * why)
+{
+    static Buffer rows;                  /* the association lines, until n is known  */
+    
+    const IndexEntry * entry = NULL;
+    
+    Dataset * ds = mode == 'r' ? &engine.rs : &engine.sr;
+    
+    AssocCursor assoc;
+    
+    ArenaMark mark = arenaMark();
+    
+    const char * word;
+    
+    int wordLen;
+    int count;
+    int status = 2;
+    int n = 0;
+    
+    long long start = traceFile != NULL ? nowNs() : 0;
+    
+    rows.len = 0;
+    
+    if(why == NULL)
+    {
+        STRUPR(cue);
+        
+        if((entry = findCue(ds, cue)) == NULL)
+        {
+            status = 1;
+        }
+        else if(!openAssoc(ds, entry, &assoc))
+        {
+            why = "bad address in index file";
+        }
+        else
+        {
+            status = 0;
+            
+            while((limit == 0 || n < limit) && nextAssoc(&assoc, &word, &wordLen, &count))
+            {
+                if(binary)
+                {
+                    put32(&rows, wordLen);
+                    
+                    bufAppend(&rows, word, wordLen);
+                    
+                    put32(&rows, count);
+                }
+                else
+                {
+                    bufPrintf(&rows, "%.*s\t%d\n", wordLen, word, count);
+                }
+                
+                n++;
+            }
+        }
+        
+        arenaRelease(mark);
+        
+        if(traceFile != NULL)
+        {
+            Layout layout = switchLayout();
+            
+            layout.limited = limit > 0;
+            layout.limit   = limit;
+            
+            traceQuery(cue, mode, &layout, entry != NULL, start, nowNs());
+        }
+    }
+    
+    if(binary)
+    {
+        put32(out, status == 0 ? 20 + rows.len : status == 1 ? 8 : 8 + strlen(why));
+        put32(out, id);
+        put32(out, status);
+        
+        if(status == 0)
+        {
+            put32(out, entry->tot_rec);
+            put32(out, entry->tot_freq);
+            put32(out, n);
+        }
+    }
+    else if(status == 0)
+    {
+        bufPrintf(out, "%lu\t0\t%d\t%d\t%d\n", id, entry->tot_rec, entry->tot_freq, n);
+    }
+    else if(status == 1)
+    {
+        bufPrintf(out, "%lu\t1\n", id);
+    }
+    else
+    {
+        bufPrintf(out, "%lu\t2\t%s\n", id, why);
+    }
+    
+    if(status == 0)
+    {
+        bufAppend(out, rows.data, rows.len);
+    }
+    else if(status == 2 && binary)
+    {
+        bufAppend(out, why, strlen(why));
+    }
+}
+
+
+
+// Parses a request line, as --pipe and --serve read them: 'id<tab>cue', optionally followed by
+// '<tab>' and any of 's' or 'r' (the direction), 'l<n>' (the limit) and - though only --serve's
+// answers show them - 'n', 't' and 'd', all as the switches.  req holds the defaults to start.
+//
+// Returns: NULL, or why the line isn't a request (req->id is set if it got that far).
+//
+static const char * parseRequest(char * line, Request * req)
+{
+    char * cue  = strchr(line, '\t');
+    char * opts = NULL;
+    char * end;
+    
+    unsigned long id = strtoul(line, &end, 10);
+    
+    if(cue == NULL || end != cue || end == line)
+    {
+        return "bad request";
+    }
+    
+    req->id = id;
+    
+    *cue++ = '\0';
+    
+    if((opts = strchr(cue, '\t')) != NULL)
+    {
+        *opts++ = '\0';
+        
+        while(*opts != '\0')
+        {
+            switch(*opts++)
+            {
+                case 's':
+                case 'r':
+                    req->mode = opts[-1];
+                    break;
+                    
+                case 'l':
+                    req->layout.limited = true;
+                    req->layout.limit   = (int)strtol(opts, &end, 10);
+                    req->layout.number  = true;
+                    
+                    if(end == opts || req->layout.limit < 0)
+                    {
+                        return "bad option";
+                    }
+                    
+                    opts = end;
+                    break;
+                    
+                case 'n':
+                    req->layout.number = true;
+                    break;
+                    
+                case 't':
+                    req->layout.tabs = true;
+                    break;
+                    
+                case 'd':
+                    req->layout.demark = false;
+                    break;
+                    
+                case ' ':
+                    break;
+                    
+                default:
+                    return "bad option";
+            }
+        }
+    }
+    
+    req->cue = cue;
+    
+    return NULL;
+}
+
+
+
+// Answers one tab-separated --pipe request.
+//
+static void pipeLine(Buffer * out, char * line, char mode, int limit)
+{
+    Request req;
+    
+    const char * why;
+    
+    memset(&req, 0, sizeof(req));
+    
+    req.mode           = mode;
+    req.layout.limited = limit > 0;
+    req.layout.limit   = limit;
+    
+    why = parseRequest(line, &req);
+    
+    answerPipe(out, false, req.id, req.mode, req.layout.limited ? req.layout.limit : 0, why == NULL ? req.cue : NULL, why);
+}
+
+
+
+// Co-process mode (--pipe): reads requests from stdin for as long as there are any and writes
+// an answer to each on stdout - with no prompts, and without waiting for one answer to be read
+// before working on the next request.  Answers go out in request order, a batch at a time:
+// whatever's answered from each read of stdin, or every PIPEFLUSH bytes if that's sooner.
+//
+// Requests are either lines (see pipeLine), or - binary - frames holding their length then id,
+// direction ('s' or 'r'), limit (0 for none) and cue, the first three 32 bits little-endian.
+//
+static void runPipe(bool binary)
+{
+    Buffer in;
+    Buffer out;
+    
+    char   chunk[PIPEFLUSH];
+    char   cue[PIPEFRAME + 1];
+    
+    char   mode  = engine.cur->mode;
+    int    limit = bLimit ? nLimit : 0;
+    
+    bool   eof = false;
+    
+    memset(&in, 0, sizeof(in));
+    memset(&out, 0, sizeof(out));
+    
+    while(!eof)
+    {
+        size_t pos = 0;
+        long   n   = (long)read(0, chunk, sizeof(chunk));
+        
+        if(n > 0)
+        {
+            bufAppend(&in, chunk, n);
+        }
+        else
+        {
+            eof = true;
+        }
+        
+        for(;;)
+        {
+            const char * p = in.data + pos;
+            size_t       left = in.len - pos;
+            
+            if(binary)
+            {
+                unsigned long len;
+                
+                if(left < 4)
+                {
+                    break;
+                }
+                
+                if((len = get32(p)) < 12 || len > (unsigned long)PIPEFRAME)
+                {
+                    // Can't find the next frame after this, so that's it.
+                    //
+                    answerPipe(&out, true, 0, mode, limit, NULL, "bad frame");
+                    
+                    eof  = true;
+                    pos  = in.len;
+                    
+                    break;
+                }
+                
+                if(left < 4 + len)
+                {
+                    break;
+                }
+                
+                memcpy(cue, p + 16, len - 12);
+                
+                cue[len - 12] = '\0';
+                
+                if(get32(p + 8) != 's' && get32(p + 8) != 'r')
+                {
+                    answerPipe(&out, true, get32(p + 4), mode, limit, NULL, "bad direction");
+                }
+                else if((int)get32(p + 12) < 0)
+                {
+                    answerPipe(&out, true, get32(p + 4), mode, limit, NULL, "bad option");
+                }
+                else
+                {
+                    answerPipe(&out, true, get32(p + 4), (char)get32(p + 8), (int)get32(p + 12), cue, NULL);
+                }
+                
+                pos += 4 + len;
+            }
+            else
+            {
+                const char * nl = (const char *)memchr(p, '\n', left);
+                size_t       len;
+                
+                if(nl == NULL && !(eof && left > 0))
+                {
+                    if(left > (size_t)PIPEFRAME)
+                    {
+                        answerPipe(&out, false, 0, mode, limit, NULL, "request too long");
+                        
+                        eof = true;
+                        pos = in.len;
+                    }
+                    
+                    break;
+                }
+                
+                len = nl != NULL ? nl - p : left;
+                
+                pos += len + (nl != NULL);
+                
+                if(len > 0 && p[len - 1] == '\r')
+                {
+                    len--;
+                }
+                
+                if(len > (size_t)PIPEFRAME)
+                {
+                    answerPipe(&out, false, 0, mode, limit, NULL, "request too long");
+                    
+                    continue;
+                }
+                
+                memcpy(cue, p, len);
+                
+                cue[len] = '\0';
+                
+                if(*cue != '\0')
+                {
+                    pipeLine(&out, cue, mode, limit);
+                }
+            }
+            
+            if(out.len >= (size_t)PIPEFLUSH)
+            {
+                flushFd(1, &out);
+            }
+        }
+        
+        // Keep any partial request for the next read.
+        //
+        if(pos > 0)
+        {
+            memmove(in.data, in.data + pos, in.len - pos);
+            
+            in.len -= pos;
+        }
+        
+        flushFd(1, &out);
+    }
+    
+    free(in.data);
+    free(out.data);
+}
+
+
+
+#ifdef __linux__
+
+// --serve: one connected client.  Its socket is closed once it has stopped sending and has had
+// all its answers (or at once, on an error), but it's only freed when no worker has one of its
+// requests - and not until the end of the epoll batch, which may have more events for it.
+//
+typedef struct Client
+{
+    int             fd;
+    Buffer          in;
+    Buffer          out;
+    unsigned int    events;              /* what epoll is watching for                */
+    int             pending;             /* requests the workers haven't answered yet */
+    bool            eof;                 /* no more requests coming                   */
+    bool            dead;                /* a read or write failed                    */
+    bool            gone;                /* on the list to be freed                   */
+    struct Client * next;                /* ... which is this                         */
+} Client;
+
+// --serve: a request on its way through a worker and back.
+//
+typedef struct ServeJob
+{
+    Client          * client;
+    Request           req;
+    char            * line;              /* the request line, which req points into   */
+    long long         start;             /* when it was read (ns)                     */
+    long long         picked;            /* when a worker took it                     */
+    Buffer            answer;
+    struct ServeJob * next;
+} ServeJob;
+
+// --serve: everything the event loop and the workers share - 'lock' guards all but 'wake' and
+// 'defaults' (which don't change).  Latencies are counted in log2 buckets of microseconds: [0]
+// is under 1us, [b] under 2^b us.
+//
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  ready;               /* signalled when a request is queued        */
+    ServeJob      * todo;                /* queued requests, oldest first             */
+    ServeJob      * todoTail;
+    ServeJob      * done;                /* answered requests, for the event loop     */
+    ServeJob      * doneTail;
+    int             wake;                /* eventfd the workers poke when they answer */
+    int             workers;
+    Request         defaults;
+    unsigned long   requests;
+    unsigned long   found;
+    unsigned long   notFound;
+    unsigned long   errors;
+    unsigned long   accepted;
+    unsigned long   clients;
+    unsigned long   latency[32];         /* read to answered                          */
+    unsigned long   service[32];         /* in the worker alone                       */
+} Server;
+
+static Server server;
+
+static int usBucket(long long ns)
+{
+    long long us = ns / 1000;
+    
+    int b = 0;
+    
+    while(us > 0 && b < 31)
+    {
+        us >>= 1;
+        b++;
+    }
+    
+    return b;
+}
+
+
+
+// Appends an answer to a --serve request: a line of 'id<tab>status<tab>length' and then 'length'
+// bytes.  Status is 0 (found), 1 (not found) or 2 (an error, the bytes saying why).
+//
+static void serveAnswer(Buffer * to, unsigned long id, int status, const char * body, size_t len)
+{
+    bufPrintf(to, "%lu\t%d\t%lu\n", id, status, (unsigned long)len);
+    
+    bufAppend(to, body, len);
+}
+
+
+
+// The --serve stats command's answer: the counters, then the latency percentiles and the
+// histograms they come from (each bucket being named for its upper bound).  Called under lock.
+//
+static void serveStats(Buffer * to)
+{
+    const unsigned long * hists[2];
+    const char          * names[2];
+    
+    unsigned long total = 0;
+    
+    int h;
+    int b;
+    
+    hists[0] = server.latency;
+    hists[1] = server.service;
+    names[0] = "latency";
+    names[1] = "service";
+    
+    bufPrintf(to, "requests %lu\nfound %lu\nnot_found %lu\nerrors %lu\n", server.requests, server.found, server.notFound, server.errors);
+    bufPrintf(to, "clients %lu\naccepted %lu\nworkers %d\n", server.clients, server.accepted, server.workers);
+    
+    {
+        unsigned long hits      = 0;
+        unsigned long misses    = 0;
+        unsigned long evictions = 0;
+        unsigned long bytes     = 0;
+        long          entries   = 0;
+        
+        cacheCounters(&hits, &misses, &evictions, &bytes, &entries);
+        
+        bufPrintf(to, "cache_hits %lu\ncache_misses %lu\ncache_evictions %lu\ncache_entries %ld\ncache_bytes %lu\n", hits, misses, evictions, entries, bytes);
+    }
+    
+    for(b = 0; b < 32; b++)
+    {
+        total += server.latency[b];
+    }
+    
+    {
+        static const double at[3]    = { 0.5, 0.99, 0.999 };
+        static const char * const pc[3] = { "p50", "p99", "p999" };
+        
+        int k;
+        
+        for(k = 0; k < 3 && total > 0; k++)
+        {
+            unsigned long seen = 0;
+            
+            for(b = 0; b < 31 && (seen += server.latency[b]) < at[k] * total; b++)
+            {
+            }
+            
+            bufPrintf(to, "latency_%s_us_lt %lu\n", pc[k], 1UL << b);
+        }
+    }
+    
+    for(h = 0; h < 2; h++)
+    {
+        for(b = 0; b < 32; b++)
+        {
+            if(hists[h][b] > 0)
+            {
+                bufPrintf(to, "%s_us_lt_%lu %lu\n", names[h], 1UL << b, hists[h][b]);
+            }
+        }
+    }
+}
+
+
+
+// A --serve worker: answers queued requests for as long as the daemon runs.
+//
+static void * serveWorker(void * arg)
+{
+    Buffer body;
+    Buffer echo;
+    
+    memset(&body, 0, sizeof(body));
+    memset(&echo, 0, sizeof(echo));
+    
+    (void)arg;
+    
+    for(;;)
+    {
+        ServeJob * job;
+        
+        bool found;
+        
+        long long         finished;
+        unsigned long long one = 1;
+        
+        pthread_mutex_lock(&server.lock);
+        
+        while(server.todo == NULL)
+        {
+            pthread_cond_wait(&server.ready, &server.lock);
+        }
+        
+        job = server.todo;
+        
+        if((server.todo = job->next) == NULL)
+        {
+            server.todoTail = NULL;
+        }
+        
+        pthread_mutex_unlock(&server.lock);
+        
+        job->picked = nowNs();
+        
+        STRUPR(job->req.cue);
+        
+        body.len = 0;
+        echo.len = 0;
+        
+        found = renderCue(job->req.mode == 'r' ? &engine.rs : &engine.sr, job->req.cue, &job->req.layout, &body, &echo);
+        
+        serveAnswer(&job->answer, job->req.id, found ? 0 : 1, body.data, body.len);
+        
+        finished = nowNs();
+        
+        if(traceFile != NULL)
+        {
+            traceQuery(job->req.cue, job->req.mode, &job->req.layout, found, job->start, finished);
+        }
+        
+        pthread_mutex_lock(&server.lock);
+        
+        server.requests++;
+        
+        if(found)
+        {
+            server.found++;
+        }
+        else
+        {
+            server.notFound++;
+        }
+        
+        server.latency[usBucket(finished - job->start)]++;
+        server.service[usBucket(finished - job->picked)]++;
+        
+        job->next = NULL;
+        
+        if(server.doneTail != NULL)
+        {
+            server.doneTail->next = job;
+        }
+        else
+        {
+            server.done = job;
+        }
+        
+        server.doneTail = job;
+        
+        pthread_mutex_unlock(&server.lock);
+        
+        if(write(server.wake, &one, sizeof(one)) < 0)
+        {
+            // Only if the count's overflowed - the event loop's woken already.
+        }
+    }
+    
+    return NULL;
+}
+
+
+
+// Sends as much of a client's waiting output as its socket will take.
+//
+static void flushClient(Client * c)
+{
+    size_t sent = 0;
+    
+    while(sent < c->out.len && !c->dead)
+    {
+        long n = (long)send(c->fd, c->out.data + sent, c->out.len - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        
+        if(n > 0)
+        {
+            sent += n;
+        }
+        else if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        else
+        {
+            c->dead = true;
+        }
+    }
+    
+    memmove(c->out.data, c->out.data + sent, c->out.len - sent);
+    
+    c->out.len -= sent;
+}
+
+
+
+// Brings a client's epoll registration up to date with what it's waiting for - closing its
+// socket if it's finished with, and putting it on the 'gone' list to be freed if no worker has
+// a request of its.
+//
+// Returns: false if it's to be freed.
+//
+static bool settleClient(int ep, Client * c, Client ** gone)
+{
+    if(c->fd >= 0 && (c->dead || (c->eof && c->pending == 0 && c->out.len == 0)))
+    {
+        epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+        
+        close(c->fd);
+        
+        c->fd = -1;
+        
+        pthread_mutex_lock(&server.lock);
+        
+        server.clients--;
+        
+        pthread_mutex_unlock(&server.lock);
+    }
+    
+    if(c->fd < 0)
+    {
+        if(c->pending > 0)
+        {
+            return true;
+        }
+        
+        if(!c->gone)
+        {
+            c->gone = true;
+            c->next = *gone;
+            
+            *gone = c;
+        }
+        
+        return false;
+    }
+    
+    {
+        unsigned int events = (c->eof ? 0 : (unsigned int)EPOLLIN) | (c->out.len > 0 ? (unsigned int)EPOLLOUT : 0);
+        
+        if(events != c->events)
+        {
+            struct epoll_event ev;
+            
+            ev.events   = events;
+            ev.data.ptr = c;
+            
+            epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev);
+            
+            c->events = events;
+        }
+    }
+    
+    return true;
+}
+
+
+
+// Acts on one line from a client: the stats command is answered there and then, anything
+// else that's a request goes to the workers.
+//
+static void serveLine(Client * c, char * line, size_t len)
+{
+    ServeJob * job = (ServeJob *)calloc(1, sizeof(ServeJob));
+    
+    const char * why;
+    
+    if(job == NULL || (job->line = (char *)malloc(len + 1)) == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    memcpy(job->line, line, len);
+    
+    job->line[len] = '\0';
+    
+    job->client = c;
+    job->req    = server.defaults;
+    job->start  = nowNs();
+    
+    why = parseRequest(job->line, &job->req);
+    
+    if(why != NULL || !strcmp(job->req.cue, ".stats"))
+    {
+        Buffer body;
+        
+        memset(&body, 0, sizeof(body));
+        
+        pthread_mutex_lock(&server.lock);
+        
+        if(why != NULL)
+        {
+            server.requests++;
+            server.errors++;
+        }
+        else
+        {
+            serveStats(&body);
+        }
+        
+        pthread_mutex_unlock(&server.lock);
+        
+        if(why != NULL)
+        {
+            serveAnswer(&c->out, job->req.id, 2, why, strlen(why));
+        }
+        else
+        {
+            serveAnswer(&c->out, job->req.id, 0, body.data, body.len);
+        }
+        
+        free(body.data);
+        free(job->line);
+        free(job);
+        
+        return;
+    }
+    
+    c->pending++;
+    
+    pthread_mutex_lock(&server.lock);
+    
+    if(server.todoTail != NULL)
+    {
+        server.todoTail->next = job;
+    }
+    else
+    {
+        server.todo = job;
+    }
+    
+    server.todoTail = job;
+    
+    pthread_cond_signal(&server.ready);
+    
+    pthread_mutex_unlock(&server.lock);
+}
+
+
+
+// Reads whatever a client has sent and acts on each complete line of it.
+//
+static void readClient(Client * c)
+{
+    size_t pos = 0;
+    
+    for(;;)
+    {
+        char chunk[16384];
+        long n = (long)read(c->fd, chunk, sizeof(chunk));
+        
+        if(n > 0)
+        {
+            bufAppend(&c->in, chunk, n);
+        }
+        else if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            if(n == 0)
+            {
+                c->eof = true;
+            }
+            else if(errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                c->dead = true;
+            }
+            
+            break;
+        }
+    }
+    
+    while(!c->dead && pos < c->in.len)
+    {
+        char * line = c->in.data + pos;
+        char * nl   = (char *)memchr(line, '\n', c->in.len - pos);
+        size_t len;
+        
+        if(nl == NULL)
+        {
+            if(c->in.len - pos > (size_t)PIPEFRAME)
+            {
+                c->dead = true;
+            }
+            
+            break;
+        }
+        
+        len  = nl - line;
+        pos += len + 1;
+        
+        if(len > 0 && line[len - 1] == '\r')
+        {
+            len--;
+        }
+        
+        if(len > 0)
+        {
+            serveLine(c, line, len);
+        }
+    }
+    
+    memmove(c->in.data, c->in.data + pos, c->in.len - pos);
+    
+    c->in.len -= pos;
+}
+
+
+
+// Daemon mode (--serve <socket>): listens on a Unix domain socket and answers lookup requests
+// from any number of clients, for as long as it runs.  Requests are lines, as for --pipe but
+// with 'n', 't' and 'd' options too, and each answer is what eatshow would print for the cue
+// (see serveAnswer) - sent as soon as it's ready, so not necessarily in request order.  A line
+// of 'id<tab>.stats' gets the request counters and latency histograms instead.
+//
+// One thread runs the epoll event loop, handing requests to -j workers (a paged, -m, dataset
+// only gets the one).
+//
+static void runServer(const char * path)
+{
+    struct sockaddr_un addr;
+    struct epoll_event ev;
+    struct epoll_event events[64];
+    
+    int listener;
+    int ep;
+    int i;
+    
+    server.workers = nBudget > 0 ? 1 : nThreads;
+    
+    memset(&addr, 0, sizeof(addr));
+    
+    if(strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "eatshow: %s: socket path too long\n", path);
+        
+        exit(1);
+    }
+    
+    addr.sun_family = AF_UNIX;
+    
+    strcpy(addr.sun_path, path);
+    
+    // Any socket file already there is taken to be left over from a previous run - but anything
+    // else there is left alone.
+    //
+    {
+        struct stat st;
+        
+        if(lstat(path, &st) == 0)
+        {
+            if(!S_ISSOCK(st.st_mode))
+            {
+                fprintf(stderr, "eatshow: %s: exists and isn't a socket\n", path);
+                
+                exit(1);
+            }
+            
+            unlink(path);
+        }
+    }
+    
+    if((listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 ||
+       bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+       listen(listener, 128) < 0)
+    {
+        fprintf(stderr, "eatshow: %s: %s\n", path, strerror(errno));
+        
+        exit(1);
+    }
+    
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.ready, NULL);
+    
+    server.wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    
+    server.defaults.mode   = engine.cur->mode;
+    server.defaults.layout = switchLayout();
+    
+    ep = epoll_create1(EPOLL_CLOEXEC);
+    
+    // The listener is told apart by a NULL data.ptr, the eventfd by &server - anything else
+    // is a Client.
+    //
+    ev.events   = EPOLLIN;
+    ev.data.ptr = NULL;
+    
+    epoll_ctl(ep, EPOLL_CTL_ADD, listener, &ev);
+    
+    ev.events   = EPOLLIN;
+    ev.data.ptr = &server;
+    
+    epoll_ctl(ep, EPOLL_CTL_ADD, server.wake, &ev);
+    
+    for(i = 0; i < server.workers; i++)
+    {
+        pthread_t thread;
+        
+        if(pthread_create(&thread, NULL, serveWorker, NULL) != 0)
+        {
+            fprintf(stderr, "eatshow: can't start workers\n");
+            
+            exit(1);
+        }
+        
+        pthread_detach(thread);
+    }
+    
+    fprintf(stderr, "eatshow: serving on %s with %d worker%s\n", path, server.workers, server.workers == 1 ? "" : "s");
+    
+    for(;;)
+    {
+        int n = epoll_wait(ep, events, sizeof(events) / sizeof(events[0]), -1);
+        
+        Client * gone = NULL;
+        
+        for(i = 0; i < n; i++)
+        {
+            if(events[i].data.ptr == NULL)
+            {
+                int fd;
+                
+                while((fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+                {
+                    Client * c = (Client *)calloc(1, sizeof(Client));
+                    
+                    if(c == NULL)
+                    {
+                        fprintf(stderr, "eatshow: out of memory\n");
+                        
+                        close(fd);
+                        
+                        continue;
+                    }
+                    
+                    c->fd     = fd;
+                    c->events = EPOLLIN;
+                    
+                    ev.events   = EPOLLIN;
+                    ev.data.ptr = c;
+                    
+                    epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+                    
+                    pthread_mutex_lock(&server.lock);
+                    
+                    server.accepted++;
+                    server.clients++;
+                    
+                    pthread_mutex_unlock(&server.lock);
+                }
+            }
+            else if(events[i].data.ptr == &server)
+            {
+                ServeJob * job;
+                
+                unsigned long long count;
+                
+                if(read(server.wake, &count, sizeof(count)) < 0)
+                {
+                    // Already reset - the answers are collected all the same.
+                }
+                
+                pthread_mutex_lock(&server.lock);
+                
+                job = server.done;
+                
+                server.done = server.doneTail = NULL;
+                
+                pthread_mutex_unlock(&server.lock);
+                
+                while(job != NULL)
+                {
+                    ServeJob * next = job->next;
+                    Client   * c    = job->client;
+                    
+                    c->pending--;
+                    
+                    if(c->fd >= 0)
+                    {
+                        bufAppend(&c->out, job->answer.data, job->answer.len);
+                        
+                        flushClient(c);
+                    }
+                    
+                    settleClient(ep, c, &gone);
+                    
+                    free(job->answer.data);
+                    free(job->line);
+                    free(job);
+                    
+                    job = next;
+                }
+            }
+            else
+            {
+                Client * c = (Client *)events[i].data.ptr;
+                
+                // Closed earlier in this batch - the event is stale.
+                //
+                if(c->fd < 0)
+                {
+                    continue;
+                }
+                
+                if(events[i].events & EPOLLOUT)
+                {
+                    flushClient(c);
+                }
+                
+                if(events[i].events & EPOLLIN)
+                {
+                    readClient(c);
+                    
+                    flushClient(c);
+                }
+                
+                // Gone altogether - there's nowhere for any answers to go.
+                //
+                if(events[i].events & (EPOLLHUP | EPOLLERR))
+                {
+                    c->dead = true;
+                }
+                
+                settleClient(ep, c, &gone);
+            }
+        }
+        
+        // Nothing in the batch can refer to them now.
+        //
+        while(gone != NULL)
+        {
+            Client * next = gone->next;
+            
+            free(gone->in.data);
+            free(gone->out.data);
+            free(gone);
+            
+            gone = next;
+        }
+    }
+}
+
+#else
+
+static void runServer(const char * path)
+{
+    fprintf(stderr, "eatshow: %s: --serve isn't supported on this platform\n", path);
+    
+    exit(1);
+}
+
+#endif
+
+
+
+
+// Nanoseconds from some fixed point - for timing, not telling the time.
+//
+static long long nowNs(void)
+{
+#ifndef _WIN32
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#else
+    return (long long)clock() * (1000000000LL / CLOCKS_PER_SEC);
+#endif
+}
+
+
+
+// With --stats, the nanoseconds since *t (and *t is moved on to now); otherwise 0.
+//
+static long long lap(long long * t)
+{
+    long long now;
+    long long ns;
+    
+    if(statsMode == 0)
+    {
+        return 0;
+    }
+    
+    now = nowNs();
+    ns  = now - *t;
+    
+    *t = now;
+    
+    return ns;
+}
+
+
+
+static void tallyAdd(Tally * to, const Tally * d)
+{
+    to->bytes      += d->bytes;
+    to->indexNs    += d->indexNs;
+    to->seekNs     += d->seekNs;
+    to->tokenizeNs += d->tokenizeNs;
+    to->formatNs   += d->formatNs;
+    to->indexLines += d->indexLines;
+    to->syscalls   += d->syscalls;
+    to->records    += d->records;
+    to->cues       += d->cues;
+    to->found      += d->found;
+    to->cached     += d->cached;
+    to->arenaAllocs += d->arenaAllocs;
+    to->arenaBytes  += d->arenaBytes;
+    to->mallocs     += d->mallocs;
+}
+
+
+
+// d = a - b.
+//
+static void tallySub(Tally * d, const Tally * a, const Tally * b)
+{
+    d->bytes      = a->bytes      - b->bytes;
+    d->indexNs    = a->indexNs    - b->indexNs;
+    d->seekNs     = a->seekNs     - b->seekNs;
+    d->tokenizeNs = a->tokenizeNs - b->tokenizeNs;
+    d->formatNs   = a->formatNs   - b->formatNs;
+    d->indexLines = a->indexLines - b->indexLines;
+    d->syscalls   = a->syscalls   - b->syscalls;
+    d->records    = a->records    - b->records;
+    d->cues       = a->cues       - b->cues;
+    d->found      = a->found      - b->found;
+    d->cached     = a->cached     - b->cached;
+    d->arenaAllocs = a->arenaAllocs - b->arenaAllocs;
+    d->arenaBytes  = a->arenaBytes  - b->arenaBytes;
+    d->mallocs     = a->mallocs     - b->mallocs;
+}
+
+
+
+// --stats: adds work that isn't any one cue's (a batch's index join) to the totals.
+//
+static void statsAdd(const Tally * d)
+{
+    pthread_mutex_lock(&statsLock);
+    
+    tallyAdd(&statsTotal, d);
+    
+    pthread_mutex_unlock(&statsLock);
+}
+
+
+
+// --stats: logs what's been done for one cue - everything on this thread's tally since 'before'.
+//
+static void statsCue(const char * cue, char mode, const Tally * before)
+{
+    CueStats cs;
+    
+    tallySub(&cs.tally, &tally, before);
+    
+    cs.tally.cues = 1;
+    cs.mode       = mode;
+    
+    if((cs.cue = (char *)malloc(strlen(cue) + 1)) != NULL)
+    {
+        strcpy(cs.cue, cue);
+    }
+    
+    pthread_mutex_lock(&statsLock);
+    
+    tallyAdd(&statsTotal, &cs.tally);
+    
+    if(ncueStats == capCueStats)
+    {
+        capCueStats = capCueStats == 0 ? 256 : capCueStats * 2;
+        
+        if((cueStats = (CueStats *)realloc(cueStats, capCueStats * sizeof(CueStats))) == NULL)
+        {
+            fprintf(stderr, "eatshow: out of memory\n");
+            
+            exit(1);
+        }
+    }
+    
+    cueStats[ncueStats++] = cs;
+    
+    pthread_mutex_unlock(&statsLock);
+}
+
+
+
+// Writes a string as a JSON string.
+//
+static void jsonString(FILE * fp, const char * s)
+{
+    fputc('"', fp);
+    
+    for(; *s != '\0'; s++)
+    {
+        if(*s == '"' || *s == '\\')
+        {
+            fprintf(fp, "\\%c", *s);
+        }
+        else if((unsigned char)*s < ' ')
+        {
+            fprintf(fp, "\\u%04x", (unsigned char)*s);
+        }
+        else
+        {
+            fputc(*s, fp);
+        }
+    }
+    
+    fputc('"', fp);
+}
+
+
+
+// Writes one tally - as JSON members, or as the summary's text.
+//
+static void printTally(FILE * fp, const Tally * t, bool json)
+{
+    if(json)
+    {
+        fprintf(fp, "\"index_us\":%.3f,\"seek_us\":%.3f,\"tokenize_us\":%.3f,\"format_us\":%.3f,", t->indexNs / 1e3, t->seekNs / 1e3, t->tokenizeNs / 1e3, t->formatNs / 1e3);
+        fprintf(fp, "\"index_lines\":%lu,\"bytes_read\":%llu,\"syscalls\":%lu,\"records\":%lu,", t->indexLines, t->bytes, t->syscalls, t->records);
+        fprintf(fp, "\"cues\":%lu,\"found\":%lu,\"cached\":%lu,", t->cues, t->found, t->cached);
+        fprintf(fp, "\"arena_allocs\":%lu,\"arena_bytes\":%llu,\"mallocs\":%lu", t->arenaAllocs, t->arenaBytes, t->mallocs);
+    }
+    else
+    {
+        fprintf(fp, "index %.1fus, seek %.1fus, tokenize %.1fus, format %.1fus; ", t->indexNs / 1e3, t->seekNs / 1e3, t->tokenizeNs / 1e3, t->formatNs / 1e3);
+        fprintf(fp, "%lu index lines, %llu bytes read, %lu syscalls, %lu records; ", t->indexLines, t->bytes, t->syscalls, t->records);
+        fprintf(fp, "%lu arena allocs (%llu bytes), %lu mallocs\n", t->arenaAllocs, t->arenaBytes, t->mallocs);
+    }
+}
+
+
+
+// --stats: at exit, writes each cue's timings and counters, and the totals, to stderr - as text,
+// or as a JSON object ('cues' and 'total') with --stats json.
+//
+static void reportStats(void)
+{
+    long i;
+    
+    pthread_mutex_lock(&statsLock);
+    
+    if(statsMode == 2)
+    {
+        fprintf(stderr, "{\"cues\":[");
+        
+        for(i = 0; i < ncueStats; i++)
+        {
+            fprintf(stderr, "%s\n{\"cue\":", i > 0 ? "," : "");
+            
+            jsonString(stderr, cueStats[i].cue != NULL ? cueStats[i].cue : "");
+            
+            fprintf(stderr, ",\"mode\":\"%c\",", cueStats[i].mode);
+            
+            printTally(stderr, &cueStats[i].tally, true);
+            
+            fprintf(stderr, "}");
+        }
+        
+        fprintf(stderr, "],\n\"total\":{");
+        
+        printTally(stderr, &statsTotal, true);
+        
+        fprintf(stderr, "}}\n");
+    }
+    else
+    {
+        for(i = 0; i < ncueStats; i++)
+        {
+            fprintf(stderr, "eatshow: %s (%c)%s: ", cueStats[i].cue != NULL ? cueStats[i].cue : "", cueStats[i].mode, cueStats[i].tally.cached ? " cached" : cueStats[i].tally.found ? "" : " not found");
+            
+            printTally(stderr, &cueStats[i].tally, false);
+        }
+        
+        fprintf(stderr, "eatshow: %lu cues (%lu found, %lu from the cache): ", statsTotal.cues, statsTotal.found, statsTotal.cached);
+        
+        printTally(stderr, &statsTotal, false);
+    }
+    
+    pthread_mutex_unlock(&statsLock);
+}
+
+
+
+// Writes out every record in the --trace ring that's ready.
+//
+static void drainTrace(void)
+{
+    for(;;)
+    {
+        TraceSlot * slot = &traceRing[traceTail & (TRACESLOTS - 1)];
+        
+        if(slot->seq.load(std::memory_order_acquire) != traceTail + 1)
+        {
+            break;
+        }
+        
+        fwrite(&slot->rec, sizeof(TraceRecord), 1, traceFile);
+        
+        slot->seq.store(traceTail + TRACESLOTS, std::memory_order_release);
+        
+        traceTail++;
+    }
+    
+    fflush(traceFile);
+}
+
+
+
+// The --trace writer thread: empties the ring every millisecond until told to stop.
+//
+static void * writeTrace(void * arg)
+{
+    (void)arg;
+    
+    while(!traceStop.load())
+    {
+        drainTrace();
+        
+#ifndef _WIN32
+        usleep(1000);
+#endif
+    }
+    
+    return NULL;
+}
+
+
+
+// At exit, stops the --trace writer and writes whatever it hadn't.
+//
+static void stopTrace(void)
+{
+    traceStop.store(1);
+    
+#ifndef _WIN32
+    pthread_join(traceWriter, NULL);
+#endif
+    
+    drainTrace();
+    
+    fclose(traceFile);
+    
+    if(traceDropped.load() > 0)
+    {
+        fprintf(stderr, "eatshow: trace: %lu queries not recorded (the ring was full)\n", traceDropped.load());
+    }
+}
+
+
+
+// Starts recording every query to a trace file (--trace <file>) - see traceQuery.
+//
+static void startTrace(const char * file)
+{
+    TraceHeader header;
+    
+    unsigned long i;
+    
+    if((traceFile = fopen(file, "wb")) == NULL || (traceRing = (TraceSlot *)calloc(TRACESLOTS, sizeof(TraceSlot))) == NULL)
+    {
+        fprintf(stderr, "eatshow: can't trace to %s\n", file);
+        
+        exit(1);
+    }
+    
+    for(i = 0; i < TRACESLOTS; i++)
+    {
+        traceRing[i].seq.store(i, std::memory_order_relaxed);
+    }
+    
+    memset(&header, 0, sizeof(header));
+    
+    memcpy(header.magic, "EATTRACE", 8);
+    
+    header.version    = TRACEVERSION;
+    header.recordSize = sizeof(TraceRecord);
+    header.byteOrder  = 0x01020304;
+    header.started    = (long long)time(NULL);
+    
+    fwrite(&header, sizeof(header), 1, traceFile);
+    
+    traceStart = nowNs();
+    
+#ifndef _WIN32
+    pthread_create(&traceWriter, NULL, writeTrace, NULL);
+#endif
+    
+    atexit(stopTrace);
+}
+
+
+
+// Records one query - which can be on any thread - in the --trace ring, for the writer thread
+// to write out.  Nothing waits: if the ring's full, the query just isn't recorded.
+//
+static void traceQuery(const char * cue, char mode, const Layout * layout, bool found, long long start, long long end)
+{
+    unsigned long pos = traceHead.load(std::memory_order_relaxed);
+    
+    TraceSlot * slot;
+    
+    size_t len = strlen(cue);
+    
+    for(;;)
+    {
+        long dif;
+        
+        slot = &traceRing[pos & (TRACESLOTS - 1)];
+        dif  = (long)(slot->seq.load(std::memory_order_acquire) - pos);
+        
+        if(dif == 0)
+        {
+            if(traceHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if(dif < 0)
+        {
+            traceDropped++;
+            
+            return;
+        }
+        else
+        {
+            pos = traceHead.load(std::memory_order_relaxed);
+        }
+    }
+    
+    slot->rec.time    = start - traceStart;
+    slot->rec.latency = end - start;
+    slot->rec.mode    = (unsigned char)mode;
+    slot->rec.flags   = (layout->tabs ? TRACE_TABS : 0) | (layout->number ? TRACE_NUMBER : 0) | (layout->demark ? TRACE_DEMARK : 0) |
+                        (layout->limited ? TRACE_LIMITED : 0) | (found ? TRACE_FOUND : 0);
+    slot->rec.limit   = layout->limit;
+    slot->rec.cueLen  = (unsigned short)(len < sizeof(slot->rec.cue) ? len : sizeof(slot->rec.cue));
+    
+    memcpy(slot->rec.cue, cue, slot->rec.cueLen);
+    
+    slot->seq.store(pos + 1, std::memory_order_release);
+    
+#ifdef _WIN32
+    drainTrace();
+#endif
+}
+
+
+
+// Prints the p50/p90/p99/p99.9/max of some latencies (sorting them), in us.
+//
+static void printLatencies(const char * name, long long * ns, long n)
+{
+    qsort(ns, n, sizeof(long long), compareNs);
+    
+    printf("%-14s %10.2f %10.2f %10.2f %10.2f %10.2f\n", name, ns[(long)(n * 0.5)] / 1e3, ns[(long)(n * 0.9)] / 1e3, ns[(long)(n * 0.99)] / 1e3, ns[(long)(n * 0.999)] / 1e3, ns[n - 1] / 1e3);
+}
+
+
+
+// Orders trace records (given as pointers) by when they started - and, as qsort isn't stable,
+// where they are in the file when that's the same.
+//
+static int compareRecords(const void * a, const void * b)
+{
+    const TraceRecord * x = *(const TraceRecord * const *)a;
+    const TraceRecord * y = *(const TraceRecord * const *)b;
+    
+    return x->time != y->time ? (x->time < y->time ? -1 : 1) : (x < y ? -1 : x > y);
+}
+
+
+
+// Replay mode (--replay <file> [max]): re-issues every query in a --trace file, each with its own
+// direction and output options, on one thread, in the order they started - at the pace they were
+// recorded, or, with 'max', back to back.  Reports the replayed latencies next to the recorded ones (and, at recorded
+// pace, how far behind schedule each query started).
+//
+static void runReplay(const char * file)
+{
+    MappedFile    mf;
+    TraceHeader   header;
+    
+    const TraceRecord  * recs;
+    const TraceRecord ** order;
+    
+    Buffer screen;
+    Buffer echo;
+    
+    long long * replayed;
+    long long * recorded;
+    long long * lag;
+    long long   begin;
+    long long   elapsed;
+    long long   first;
+    long long   last;
+    
+    long nrecs;
+    long found = 0;
+    long i;
+    
+    if(!mapFile(file, &mf) || mf.size < (long)sizeof(TraceHeader))
+    {
+        fprintf(stderr, "eatshow: %s: can't read trace\n", file);
+        
+        exit(1);
+    }
+    
+    memcpy(&header, mf.base, sizeof(header));
+    
+    if(memcmp(header.magic, "EATTRACE", 8) || header.version != TRACEVERSION || header.recordSize != sizeof(TraceRecord) || header.byteOrder != 0x01020304)
+    {
+        fprintf(stderr, "eatshow: %s: not a trace this build can read\n", file);
+        
+        exit(1);
+    }
+    
+    recs  = (const TraceRecord *)(mf.base + sizeof(TraceHeader));
+    nrecs = (mf.size - (long)sizeof(TraceHeader)) / (long)sizeof(TraceRecord);
+    
+    if(nrecs == 0)
+    {
+        printf("%s: no queries\n", file);
+        
+        return;
+    }
+    
+    replayed = (long long *)malloc(nrecs * sizeof(long long));
+    recorded = (long long *)malloc(nrecs * sizeof(long long));
+    lag      = (long long *)malloc(nrecs * sizeof(long long));
+    order    = (const TraceRecord **)malloc(nrecs * sizeof(TraceRecord *));
+    
+    if(replayed == NULL || recorded == NULL || lag == NULL || order == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    memset(&screen, 0, sizeof(screen));
+    memset(&echo, 0, sizeof(echo));
+    
+    // A damaged record could claim a longer cue than it holds, so each is checked before any is
+    // replayed.  Queries from more than one thread needn't be in time order in the file, so
+    // they're sorted - replaying them as written would put some behind schedule that weren't.
+    //
+    for(i = 0; i < nrecs; i++)
+    {
+        if(recs[i].cueLen > sizeof(recs[i].cue) || (recs[i].mode != 's' && recs[i].mode != 'r'))
+        {
+            fprintf(stderr, "eatshow: %s: record %ld is corrupt\n", file, i + 1);
+            
+            exit(1);
+        }
+        
+        order[i] = &recs[i];
+    }
+    
+    qsort(order, nrecs, sizeof(TraceRecord *), compareRecords);
+    
+    first = order[0]->time;
+    last  = order[nrecs - 1]->time;
+    
+    begin = nowNs();
+    
+    for(i = 0; i < nrecs; i++)
+    {
+        const TraceRecord * r = order[i];
+        
+        Layout layout;
+        
+        char cue[sizeof(r->cue) + 1];
+        
+        long long start;
+        
+        memcpy(cue, r->cue, r->cueLen);
+        
+        cue[r->cueLen] = '\0';
+        
+        layout.tabs    = (r->flags & TRACE_TABS) != 0;
+        layout.number  = (r->flags & TRACE_NUMBER) != 0;
+        layout.demark  = (r->flags & TRACE_DEMARK) != 0;
+        layout.limited = (r->flags & TRACE_LIMITED) != 0;
+        layout.limit   = r->limit;
+        layout.format  = outFormat;
+        
+        if(!bReplayMax)
+        {
+            long long due = begin + (r->time - first);
+            long long now = nowNs();
+            
+            // Sleep for all but the last 100us of any wait, then spin.
+            //
+#ifndef _WIN32
+            if(due - now > 200000)
+            {
+                usleep((useconds_t)((due - now - 100000) / 1000));
+            }
+#endif
+            
+            while((now = nowNs()) < due)
+            {
+            }
+            
+            lag[i] = now - due;
+        }
+        
+        screen.len = 0;
+        echo.len   = 0;
+        
+        start = nowNs();
+        
+        found += renderCue(r->mode == 'r' ? &engine.rs : &engine.sr, cue, &layout, &screen, &echo);
+        
+        replayed[i] = nowNs() - start;
+        recorded[i] = r->latency;
+    }
+    
+    elapsed = nowNs() - begin;
+    
+    printf("%s: %ld queries (%ld found) replayed in %.3fs%s - %.0f/s; recorded over %.3fs\n\n", file, nrecs, found, elapsed / 1e9, bReplayMax ? " flat out" : "", nrecs / (elapsed / 1e9), (last - first) / 1e9);
+    
+    printf("%-14s %10s %10s %10s %10s %10s\n", "us", "p50", "p90", "p99", "p99.9", "max");
+    
+    printLatencies("replayed", replayed, nrecs);
+    printLatencies("recorded", recorded, nrecs);
+    
+    if(!bReplayMax)
+    {
+        printLatencies("behind", lag, nrecs);
+    }
+    
+    free(order);
+    free(lag);
+    free(recorded);
+    free(replayed);
+    free(screen.data);
+    free(echo.data);
+    
+    unmapFile(&mf);
+}
+
+
+
+// One --bench lookup, and how long it took.
+//
+typedef struct
+{
+    Dataset   * ds;
+    size_t      cue;                     /* offset of the cue in the bench's text                 */
+    long long   ns;
+    bool        found;
+} BenchCue;
+
+// One --bench thread's share of a phase: every 'step'th cue from 'first'.
+//
+typedef struct
+{
+    BenchCue         * cues;
+    long               ncues;
+    long               first;
+    long               step;
+    const char       * text;
+    Layout             layout;
+    unsigned long long bytes;
+} BenchThread;
+
+static int compareNs(const void * a, const void * b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    
+    return x < y ? -1 : x > y;
+}
+
+
+
+// Does one --bench thread's lookups, timing each.  The output's rendered (as checkForWord does)
+// but not written anywhere.
+//
+static void * benchLookups(void * arg)
+{
+    BenchThread * bt = (BenchThread *)arg;
+    
+    Buffer screen;
+    Buffer echo;
+    
+    unsigned long long bytes = tally.bytes;
+    
+    long i;
+    
+    memset(&screen, 0, sizeof(screen));
+    memset(&echo, 0, sizeof(echo));
+    
+    for(i = bt->first; i < bt->ncues; i += bt->step)
+    {
+        BenchCue * bc = &bt->cues[i];
+        
+        long long start = nowNs();
+        
+        screen.len = 0;
+        echo.len   = 0;
+        
+        bc->found = renderCue(bc->ds, bt->text + bc->cue, &bt->layout, &screen, &echo);
+        bc->ns    = nowNs() - start;
+    }
+    
+    bt->bytes = tally.bytes - bytes;
+    
+    free(screen.data);
+    free(echo.data);
+    
+    return NULL;
+}
+
+
+
+// Runs one --bench phase - every cue, on 'threads' threads - and reports it, to stdout and as a
+// line of the results file.
+//
+static void benchPhase(FILE * results, const char * phase, BenchCue * cues, long ncues, const char * text, int threads)
+{
+    BenchThread * bts     = (BenchThread *)calloc(threads, sizeof(BenchThread));
+    pthread_t   * handles = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    long long   * ns      = (long long *)malloc(ncues * sizeof(long long));
+    
+    unsigned long hits      = 0;
+    unsigned long misses    = 0;
+    unsigned long evictions = 0;
+    unsigned long cacheSize = 0;
+    unsigned long cached;
+    long          entries   = 0;
+    long          ioBytes   = bufferPool.bytesRead;
+    long          found     = 0;
+    long          i;
+    
+    unsigned long long bytes = 0;
+    
+    long long start;
+    long long elapsed;
+    
+    double secs;
+    
+    if(bts == NULL || handles == NULL || ns == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    cacheCounters(&hits, &misses, &evictions, &cacheSize, &entries);
+    
+    cached = hits;
+    
+    start = nowNs();
+    
+    for(i = 0; i < threads; i++)
+    {
+        bts[i].cues   = cues;
+        bts[i].ncues  = ncues;
+        bts[i].first  = i;
+        bts[i].step   = threads;
+        bts[i].text   = text;
+        bts[i].layout = switchLayout();
+        
+        if(threads > 1)
+        {
+            pthread_create(&handles[i], NULL, benchLookups, &bts[i]);
+        }
+        else
+        {
+            benchLookups(&bts[i]);
+        }
+    }
+    
+    for(i = 0; i < threads; i++)
+    {
+        if(threads > 1)
+        {
+            pthread_join(handles[i], NULL);
+        }
+        
+        bytes += bts[i].bytes;
+    }
+    
+    elapsed = nowNs() - start;
+    secs    = elapsed / 1e9;
+    ioBytes = bufferPool.bytesRead - ioBytes;
+    
+    hits = 0;
+    
+    cacheCounters(&hits, &misses, &evictions, &cacheSize, &entries);
+    
+    cached = hits - cached;
+    
+    for(i = 0; i < ncues; i++)
+    {
+        ns[i]  = cues[i].ns;
+        found += cues[i].found;
+    }
+    
+    qsort(ns, ncues, sizeof(long long), compareNs);
+    
+    {
+        double p50  = ns[(long)(ncues * 0.5)] / 1e3;
+        double p99  = ns[(long)(ncues * 0.99)] / 1e3;
+        double p999 = ns[(long)(ncues * 0.999)] / 1e3;
+        double rate = secs > 0 ? ncues / secs : 0;
+        
+        printf("%-10s %3d %8ld %8ld %9.3f %11.0f %9.2f %9.2f %9.2f %12llu %10ld %8lu\n", phase, threads, ncues, found, secs, rate, p50, p99, p999, bytes, ioBytes, cached);
+        
+        fprintf(results, "%s\t%d\t%ld\t%ld\t%.6f\t%.0f\t%.3f\t%.3f\t%.3f\t%llu\t%ld\t%lu\n", phase, threads, ncues, found, secs, rate, p50, p99, p999, bytes, ioBytes, cached);
+    }
+    
+    free(ns);
+    free(handles);
+    free(bts);
+}
+
+
+
+// Adds every headword of a dataset, and a miss made from each, to a --bench cue list.
+//
+static void benchVocabulary(Dataset * ds, Buffer * text, BenchCue ** cues, long * ncues, long * cap)
+{
+    long pos   = 0;
+    long count = 0;
+    
+    for(;;)
+    {
+        IndexEntry e;
+        
+        int k;
+        
+        if(ds->paged)
+        {
+            char window[512];
+            long n;
+            
+            if(pos >= ds->pindex.end)
+            {
+                break;
+            }
+            
+            n = pagedRead(&ds->pindex.file, pos, window, sizeof(window));
+            
+            pos += parseIndexLine(window, window + n, &e);
+        }
+        else
+        {
+            if(count >= ds->index.nentries)
+            {
+                break;
+            }
+            
+            e = ds->index.entries[count];
+        }
+        
+        count++;
+        
+        for(k = 0; k < 2; k++)
+        {
+            if(*ncues == *cap)
+            {
+                *cap = *cap == 0 ? 65536 : *cap * 2;
+                
+                if((*cues = (BenchCue *)realloc(*cues, *cap * sizeof(BenchCue))) == NULL)
+                {
+                    fprintf(stderr, "eatshow: out of memory\n");
+                    
+                    exit(1);
+                }
+            }
+            
+            (*cues)[*ncues].ds  = ds;
+            (*cues)[*ncues].cue = text->len;
+            
+            (*ncues)++;
+            
+            bufAppend(text, e.key, strlen(e.key));
+            
+            // No headword has a '#' in it.
+            //
+            bufAppend(text, k == 0 ? "" : "#", k + 1);
+        }
+    }
+}
+
+
+
+// Benchmark mode (--bench [file]): looks up every headword of both directions, and a miss for
+// each, in a fixed shuffled order - cold (with the result cache and buffer pool emptied) and
+// then warm, on one thread and then on many (-j, or one per CPU; just the one with -m).  Each
+// phase's p50/p99/p99.9 latency in us, lookups/sec, association list bytes read, bytes read
+// from the files (-m) and cache hits go to stdout and, tab-separated, to the results file.
+//
+// The current switches apply: --text, -m, -c and the output ones.
+//
+static void runBench(const char * file)
+{
+    BenchCue * cues = NULL;
+    FILE     * results;
+    Buffer     text;
+    
+    long ncues = 0;
+    long cap   = 0;
+    long i;
+    
+    int threads = nBudget > 0 ? 1 : workThreads();
+    
+    unsigned long long seed = 88172645463325252ULL;
+    
+    if((results = fopen(file, "w")) == NULL)
+    {
+        printf("Error opening %s\n", file);
+        
+        return;
+    }
+    
+    memset(&text, 0, sizeof(text));
+    
+    benchVocabulary(&engine.sr, &text, &cues, &ncues, &cap);
+    benchVocabulary(&engine.rs, &text, &cues, &ncues, &cap);
+    
+    // Shuffled the same way every time, so that results can be compared.
+    //
+    for(i = ncues - 1; i > 0; i--)
+    {
+        BenchCue t;
+        long     k;
+        
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        
+        k = (long)(seed % (unsigned long long)(i + 1));
+        
+        t       = cues[i];
+        cues[i] = cues[k];
+        cues[k] = t;
+    }
+    
+    fprintf(results, "# eatshow --bench: %s, cache %ld KB\n", engine.snap.base != NULL ? "snapshot" : nBudget > 0 ? "paged" : "text", (long)(cacheBudget * CACHESHARDS / 1024));
+    fprintf(results, "phase\tthreads\tlookups\tfound\tseconds\tlookups_per_sec\tp50_us\tp99_us\tp999_us\tbytes_read\tio_bytes\tcache_hits\n");
+    
+    printf("%-10s %3s %8s %8s %9s %11s %9s %9s %9s %12s %10s %8s\n", "phase", "thr", "lookups", "found", "seconds", "lookups/s", "p50 us", "p99 us", "p99.9 us", "bytes read", "io bytes", "cached");
+    
+    emptyCache();
+    emptyPool();
+    
+    benchPhase(results, "st-cold", cues, ncues, text.data, 1);
+    benchPhase(results, "st-warm", cues, ncues, text.data, 1);
+    
+    emptyCache();
+    emptyPool();
+    
+    benchPhase(results, "mt-cold", cues, ncues, text.data, threads);
+    benchPhase(results, "mt-warm", cues, ncues, text.data, threads);
+    
+    fclose(results);
+    
+    free(cues);
+    free(text.data);
+}
+
+
+
+// Decodes one association list for --bench-split, the way eatshow always used to - copied
+// out, then strtok on '|' and atoi.  (strtok skips empty fields, so a list with an empty
+// word in it comes apart from there on.)
+//
+// Returns: the number of pairs, and adds each one's word length and count to *sum.
+//
+static long splitStrtok(const Dataset * ds, const IndexEntry * entry, Buffer * copy, unsigned long long * sum)
+{
+    Record rec;
+    char * out1 = NULL;
+    char * out2;
+    
+    long n = 0;
+    
+    if(!getRecord(ds, entry->tail_address, &rec))
+    {
+        return 0;
+    }
+    
+    copy->len = 0;
+    
+    bufAppend(copy, rec.ptr, rec.len);
+    bufAppend(copy, "", 1);
+    
+    while((out1 = strtok(out1 == NULL ? copy->data : (char *)0, "|")) != NULL && (out2 = strtok((char *)0, "|")) != NULL)
+    {
+        *sum += strlen(out1) + atoi(out2);
+        
+        n++;
+    }
+    
+    return n;
+}
+
+
+
+// Decodes one association list for --bench-split with the splitter.
+//
+// Returns: as splitStrtok.
+//
+static long splitCursor(Dataset * ds, const IndexEntry * entry, unsigned long long * sum)
+{
+    AssocCursor  cur;
+    const char * word;
+    int          wordLen;
+    int          count;
+    
+    long n = 0;
+    
+    if(!openAssoc(ds, entry, &cur))
+    {
+        return 0;
+    }
+    
+    while(nextAssoc(&cur, &word, &wordLen, &count))
+    {
+        *sum += wordLen + count;
+        
+        n++;
+    }
+    
+    return n;
+}
+
+
+
+// --bench-split: decodes every association list in both text files 'rounds' times, first with
+// strtok and atoi and then with the splitter, and reports the time per list.  A first, untimed,
+// pass counts any lists the two read differently.
+//
+static void runSplitBench(int rounds)
+{
+    Dataset * dirs[2] = { &engine.sr, &engine.rs };
+    Buffer    copy;
+    
+    unsigned long long sum   = 0;
+    unsigned long long bytes = 0;
+    long long          ns[2];
+    long               lists = 0;
+    long               pairs = 0;
+    long               odd   = 0;
+    
+    int way;
+    int r;
+    int d;
+    int i;
+    
+    bTextOnly  = true;
+    bTranspose = false;
+    nBudget    = 0;
+    
+    loadEngine();
+    
+    memset(&copy, 0, sizeof(copy));
+    
+    for(d = 0; d < 2; d++)
+    {
+        HeadwordIndex * idx = &dirs[d]->index;
+        
+        for(i = 0; i < idx->nentries; i++)
+        {
+            unsigned long long sums[2] = { 0, 0 };
+            
+            long n = splitCursor(dirs[d], &idx->entries[i], &sums[1]);
+            
+            copy.len = 0;
+            
+            if(splitStrtok(dirs[d], &idx->entries[i], &copy, &sums[0]) != n || sums[0] != sums[1])
+            {
+                odd++;
+            }
+            
+            bytes += copy.len > 0 ? copy.len - 1 : 0;
+            pairs += n;
+            lists++;
+        }
+    }
+    
+    for(way = 0; way < 2; way++)
+    {
+        long long start = nowNs();
+        
+        for(r = 0; r < rounds; r++)
+        {
+            for(d = 0; d < 2; d++)
+            {
+                HeadwordIndex * idx = &dirs[d]->index;
+                
+                for(i = 0; i < idx->nentries; i++)
+                {
+                    if(way == 0)
+                    {
+                        splitStrtok(dirs[d], &idx->entries[i], &copy, &sum);
+                    }
+                    else
+                    {
+                        splitCursor(dirs[d], &idx->entries[i], &sum);
+                    }
+                }
+            }
+        }
+        
+        ns[way] = nowNs() - start;
+    }
+
+#if defined(SPLIT_AVX2)
+    printf("splitter: AVX2\n");
+#elif defined(SPLIT_SSE2)
+    printf("splitter: SSE2\n");
+#else
+    printf("splitter: plain C\n");
+#endif
+    printf("%ld lists, %ld pairs, %llu bytes, %d rounds (checksum %llu)\n", lists, pairs, bytes, rounds, sum);
+    
+    for(way = 0; way < 2; way++)
+    {
+        printf("%-12s %9.1f ns/list %9.1f MB/s\n", way == 0 ? "strtok+atoi" : "splitter", (double)ns[way] / ((double)lists * rounds), bytes * rounds / (ns[way] / 1e9) / 1e6);
+    }
+    
+    printf("speedup      %9.2fx\n", (double)ns[0] / ns[1]);
+    
+    if(odd > 0)
+    {
+        printf("%ld lists read differently by strtok (it skips empty words)\n", odd);
+    }
+    
+    free(copy.data);
+}
+
+
+
+// One association of a --generate thesaurus, as spilled for the r-s transpose - the words
+// are numbered copy * (real headwords) + the real headword.
+//
+typedef struct
+{
+    unsigned int resp;
+    unsigned int stim;
+    int          count;
+} GenPair;
+
+// Compares two GenPairs for writing the r-s file: by response, then most frequent first, then
+// by stimulus - which is how the shipped r-s lists are ordered.
+//
+static int comparePairs(const void * a, const void * b)
+{
+    const GenPair * x = (const GenPair *)a;
+    const GenPair * y = (const GenPair *)b;
+    
+    if(x->resp != y->resp)
+    {
+        return x->resp < y->resp ? -1 : 1;
+    }
+    
+    if(x->count != y->count)
+    {
+        return x->count > y->count ? -1 : 1;
+    }
+    
+    return x->stim < y->stim ? -1 : x->stim > y->stim ? 1 : 0;
+}
+
+
+
+// xorshift64* - the generator only needs something quick and repeatable.
+//
+static unsigned long long genRandom(unsigned long long * state)
+{
+    unsigned long long x = *state;
+    
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    
+    *state = x;
+    
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+
+
+// Names copy 'copy' of a real headword - the first copy is the word itself, the rest are
+// 'WORD~copy'.
+//
+static void genName(char * name, const char * key, long copy)
+{
+    if(copy == 0)
+    {
+        strcpy(name, key);
+    }
+    else
+    {
+        sprintf(name, "%s~%ld", key, copy);
+    }
+}
+
+
+
+// Appends one line of an index file as the shipped ones are: the key in a 20 char column (cut
+// to 19 chars and a '%' if it's longer), then 'tot_rec tot_freq head tail'.
+//
+static void putIndexLine(Buffer * buf, const char * name, int nameLen, int tot_rec, int tot_freq, long head, long tail)
+{
+    if(nameLen > 20)
+    {
+        bufPrintf(buf, "%.19s%% %d %d %ld %ld\n", name, tot_rec, tot_freq, head, tail);
+    }
+    else
+    {
+        bufPrintf(buf, "%-20.*s %d %d %ld %ld\n", nameLen, name, tot_rec, tot_freq, head, tail);
+    }
+}
+
+
+
+// Writes one line of a --generate index file - see putIndexLine.
+//
+static void genIndexLine(FILE * fp, const char * name, int tot_rec, int tot_freq, long head, long tail)
+{
+    static Buffer line;
+    
+    line.len = 0;
+    
+    putIndexLine(&line, name, (int)strlen(name), tot_rec, tot_freq, head, tail);
+    
+    fwrite(line.data, 1, line.len, fp);
+}
+
+
+
+// Opens one of --generate's files in 'dir', with a big buffer.
+//
+static FILE * genOpen(const char * dir, const char * file, const char * mode)
+{
+    char   path[4096];
+    FILE * fp;
+    
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    
+    if((fp = fopen(path, mode)) == NULL)
+    {
+        fprintf(stderr, "eatshow: cannot open %s\n", path);
+        
+        exit(1);
+    }
+    
+    setvbuf(fp, NULL, _IOFBF, 1 << 20);
+    
+    return fp;
+}
+
+
+
+// Writes a synthetic thesaurus 'scale' times the size of the shipped one to 'dir' - the four
+// text files, in exactly their format, for --data to load.
+//
+// Every real s-r headword is copied 'scale' times.  Each copy takes the counts of a real s-r
+// list picked at random (so list lengths and the shape of the counts within a list are the
+// real ones), and draws that many different responses from 'scale' copies of the real r-s
+// headwords, each as likely as the real word's total count makes it - the same Zipfian
+// spread the shipped files have.  The r-s files are then the exact transpose of the s-r ones,
+// as the shipped r-s files are.
+//
+// Transposing in memory would take 12 bytes an association (~325K of them at 1x), so the
+// pairs are spilled to disk in runs of about GENBUCKET, each covering a range of responses,
+// and each run is sorted and written in turn.
+//
+static void generateData(const char * scaleArg, const char * dir)
+{
+    HeadwordIndex * si = &engine.sr.index;
+    HeadwordIndex * ri = &engine.rs.index;
+    
+    const IndexEntry  ** stims  = NULL;  /* the real s-r headwords                                */
+    const IndexEntry  ** resps  = NULL;  /* the real r-s headwords                                */
+    int                * counts = NULL;  /* each real s-r list's counts, end to end               */
+    long               * first  = NULL;  /* where each of those starts (nstims + 1 of them)       */
+    unsigned long long * cum    = NULL;  /* running total of the r-s headwords' tot_freqs         */
+    FILE              ** runs   = NULL;
+    
+    long nstims = 0;
+    long nresps = 0;
+    long ncount = 0;
+    long scale  = atol(scaleArg);
+    long srPos  = 0;
+    long rsPos  = 0;
+    long nruns;
+    long width;
+    long c;
+    long s;
+    long i;
+    
+    unsigned long long state = 0x9E3779B97F4A7C15ULL;
+    unsigned long long pairs = 0;
+    
+    long long start = nowNs();
+    
+    FILE * srData;
+    FILE * srIndex;
+    FILE * rsData;
+    FILE * rsIndex;
+    
+    char head[64];
+    char name[64];
+    char file[64];
+    
+    struct stat st;
+    
+    if(scale < 1)
+    {
+        usage();
+    }
+    
+    // Before any of the work, rather than when the first file can't be opened.
+    //
+    if(stat(dir, &st) != 0 || (st.st_mode & S_IFMT) != S_IFDIR)
+    {
+        fprintf(stderr, "eatshow: %s: %s\n", dir, stat(dir, &st) != 0 ? "no such directory" : "not a directory");
+        
+        exit(1);
+    }
+    
+    nBudget = 0;
+    
+    loadEngine();
+    
+    stims = (const IndexEntry **)malloc(si->nentries * sizeof(IndexEntry *));
+    resps = (const IndexEntry **)malloc(ri->nentries * sizeof(IndexEntry *));
+    first = (long *)malloc((si->nentries + 1) * sizeof(long));
+    cum   = (unsigned long long *)malloc(ri->nentries * sizeof(unsigned long long));
+    
+    if(stims == NULL || resps == NULL || first == NULL || cum == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    // The real headwords, in file order - just the first of any that share a key, as that's
+    // the only one a lookup finds.
+    //
+    for(i = 0; i < si->nentries; i++)
+    {
+        const IndexEntry * t = lookupIndex(si, si->entries[i].key);
+        
+        AssocCursor  cur;
+        const char * word;
+        int          wordLen;
+        int          count;
+        
+        if(t == NULL || t->tail_address != si->entries[i].tail_address || !openAssoc(&engine.sr, t, &cur))
+        {
+            continue;
+        }
+        
+        first[nstims]   = ncount;
+        stims[nstims++] = t;
+        
+        while(nextAssoc(&cur, &word, &wordLen, &count))
+        {
+            if((ncount & 1023) == 0 && (counts = (int *)realloc(counts, (ncount + 1024) * sizeof(int))) == NULL)
+            {
+                fprintf(stderr, "eatshow: out of memory\n");
+                
+                exit(1);
+            }
+            
+            counts[ncount++] = count;
+        }
+    }
+    
+    first[nstims] = ncount;
+    
+    for(i = 0; i < ri->nentries; i++)
+    {
+        const IndexEntry * t = lookupIndex(ri, ri->entries[i].key);
+        
+        if(t == NULL || t->tail_address != ri->entries[i].tail_address || t->tot_freq <= 0)
+        {
+            continue;
+        }
+        
+        cum[nresps]     = (nresps > 0 ? cum[nresps - 1] : 0) + t->tot_freq;
+        resps[nresps++] = t;
+    }
+    
+    if(nstims == 0 || nresps == 0 || ncount == 0)
+    {
+        fprintf(stderr, "eatshow: no data to generate from\n");
+        
+        exit(1);
+    }
+    
+    // Enough runs that each holds about GENBUCKET pairs.
+    //
+    nruns = (long)(((unsigned long long)ncount * scale + GENBUCKET - 1) / GENBUCKET);
+    width = (nresps * scale + nruns - 1) / nruns;
+    
+    if((runs = (FILE **)malloc(nruns * sizeof(FILE *))) == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    for(i = 0; i < nruns; i++)
+    {
+        sprintf(file, "generate.%ld.tmp", i);
+        
+        runs[i] = genOpen(dir, file, "w+b");
+    }
+    
+    srData  = genOpen(dir, "sr_concise", "wb");
+    srIndex = genOpen(dir, "sr_index", "wb");
+    
+    for(c = 0; c < scale; c++)
+    {
+        for(s = 0; s < nstims; s++)
+        {
+            long     t        = (long)(genRandom(&state) % nstims);
+            int      n        = (int)(first[t + 1] - first[t]);
+            int      tot_freq = 0;
+            long     at       = srPos;
+            unsigned picked[128];
+            int      k;
+            
+            if(n > (int)(sizeof(picked) / sizeof(picked[0])))
+            {
+                n = (int)(sizeof(picked) / sizeof(picked[0]));
+            }
+            
+            genName(head, stims[s]->key, c);
+            
+            srPos += fprintf(srData, "%s\n", head);
+            
+            for(k = 0; k < n; k++)
+            {
+                GenPair p;
+                
+                int j;
+                
+                // A response not already in this list, as likely as its real total says.
+                //
+                do
+                {
+                    unsigned long long r  = genRandom(&state) % cum[nresps - 1];
+                    long               lo = 0;
+                    long               hi = nresps - 1;
+                    
+                    while(lo < hi)
+                    {
+                        long mid = (lo + hi) / 2;
+                        
+                        if(cum[mid] > r)
+                        {
+                            hi = mid;
+                        }
+                        else
+                        {
+                            lo = mid + 1;
+                        }
+                    }
+                    
+                    picked[k] = (unsigned)((genRandom(&state) % scale) * nresps + lo);
+                    
+                    for(j = 0; j < k && picked[j] != picked[k]; j++)
+                        ;
+                }
+                while(j < k);
+                
+                p.resp  = picked[k];
+                p.stim  = (unsigned)(c * nstims + s);
+                p.count = counts[first[t] + k];
+                
+                fwrite(&p, sizeof(p), 1, runs[p.resp / width]);
+                
+                genName(name, resps[p.resp % nresps]->key, p.resp / nresps);
+                
+                srPos += fprintf(srData, k == 0 ? "%s|%d" : "|%s|%d", name, p.count);
+                
+                tot_freq += p.count;
+            }
+            
+            srPos += fprintf(srData, "\n");
+            
+            genIndexLine(srIndex, head, n, tot_freq, at, at + (long)strlen(head) + 1);
+            
+            pairs += n;
+        }
+    }
+    
+    fclose(srData);
+    fclose(srIndex);
+    
+    rsData  = genOpen(dir, "rs_concise", "wb");
+    rsIndex = genOpen(dir, "rs_index", "wb");
+    
+    // Each run in turn - sorted, it's a run of whole r-s lists.
+    //
+    for(i = 0; i < nruns; i++)
+    {
+        long      n = ftell(runs[i]) / (long)sizeof(GenPair);
+        GenPair * p = (GenPair *)malloc(n > 0 ? n * sizeof(GenPair) : 1);
+        long      k;
+        
+        if(p == NULL)
+        {
+            fprintf(stderr, "eatshow: out of memory\n");
+            
+            exit(1);
+        }
+        
+        rewind(runs[i]);
+        
+        if((long)fread(p, sizeof(GenPair), n, runs[i]) != n)
+        {
+            fprintf(stderr, "eatshow: cannot read back generate.%ld.tmp\n", i);
+            
+            exit(1);
+        }
+        
+        fclose(runs[i]);
+        
+        snprintf(name, sizeof(name), "%s/generate.%ld.tmp", dir, i);
+        
+        remove(name);
+        
+        qsort(p, n, sizeof(GenPair), comparePairs);
+        
+        for(k = 0; k < n; )
+        {
+            long at       = rsPos;
+            int  tot_freq = 0;
+            long j;
+            
+            genName(head, resps[p[k].resp % nresps]->key, p[k].resp / nresps);
+            
+            rsPos += fprintf(rsData, "%s\n", head);
+            
+            for(j = k; j < n && p[j].resp == p[k].resp; j++)
+            {
+                genName(name, stims[p[j].stim % nstims]->key, p[j].stim / nstims);
+                
+                rsPos += fprintf(rsData, j == k ? "%s|%d" : "|%s|%d", name, p[j].count);
+                
+                tot_freq += p[j].count;
+            }
+            
+            rsPos += fprintf(rsData, "\n");
+            
+            genIndexLine(rsIndex, head, (int)(j - k), tot_freq, at, at + (long)strlen(head) + 1);
+            
+            k = j;
+        }
+        
+        free(p);
+    }
+    
+    fclose(rsData);
+    fclose(rsIndex);
+    
+    printf("eatshow: %ldx: %ld s-r headwords, %llu associations, %ld + %ld bytes of data in %s (%.1fs)\n",
+           scale, nstims * scale, pairs, srPos, rsPos, dir, (nowNs() - start) / 1e9);
+    
+    free(stims);
+    free(resps);
+    free(counts);
+    free(first);
+    free(cum);
+    free(runs);
+}
+
+
+
+// One --build-index thread's share of a data file: the whole lines from start up to end, and
+// the index lines of the records whose headwords are among them.
+//
+typedef struct
+{
+    const char * base;                   /* the data file - offsets are from here                 */
+    const char * start;
+    const char * end;
+    const char * fileEnd;                /* a record's list may run on past end, up to here       */
+    long         lines;                  /* first pass: the lines from start to end               */
+    long         firstLine;              /* ... and so, the line number of start                  */
+    long         records;
+    long long    pairs;
+    bool         stray;                  /* a headword without its list, at the end of the file   */
+    Buffer       out;
+} IndexChunk;
+
+
+
+// --build-index's first pass - counts a chunk's lines, so that each chunk knows whether it
+// starts on a headword line (an even one) or on a list line.
+//
+static void * countChunk(void * arg)
+{
+    IndexChunk * c = (IndexChunk *)arg;
+    const char * p = c->start;
+    
+    while(p < c->end && (p = (const char *)memchr(p, '\n', c->end - p)) != NULL)
+    {
+        c->lines++;
+        p++;
+    }
+    
+    return NULL;
+}
+
+
+
+// --build-index's second pass - writes the index lines of the records that start in a chunk.
+// The associations are counted, and their counts totalled, with the splitter.
+//
+static void * indexChunk(void * arg)
+{
+    IndexChunk * c = (IndexChunk *)arg;
+    const char * p = c->start;
+    
+    // Starting on a list line, the first headword is the next line.
+    //
+    if((c->firstLine & 1) && p < c->end)
+    {
+        const char * nl = (const char *)memchr(p, '\n', c->end - p);
+        
+        p = nl != NULL ? nl + 1 : c->end;
+    }
+    
+    while(p < c->end)
+    {
+        const char * nl = (const char *)memchr(p, '\n', c->fileEnd - p);
+        const char * list;
+        const char * word;
+        int          wordLen;
+        int          count;
+        int          tot_rec  = 0;
+        int          tot_freq = 0;
+        
+        AssocCursor cur;
+        
+        // A headword needs a list line after it - the last line of sr_concise doesn't have one.
+        //
+        if(nl == NULL || (list = nl + 1) >= c->fileEnd)
+        {
+            c->stray = true;
+            
+            break;
+        }
+        
+        startSplit(&cur, list, c->fileEnd);
+        
+        while(nextPair(&cur, &word, &wordLen, &count))
+        {
+            tot_rec++;
+            tot_freq += count;
+        }
+        
+        putIndexLine(&c->out, p, (int)(nl - p), tot_rec, tot_freq, (long)(p - c->base), (long)(list - c->base));
+        
+        c->records++;
+        c->pairs += tot_rec;
+        
+        // On past the list's newline (nextPair stopped at it, or at the end of the file).
+        //
+        p = cur.end < c->fileEnd ? cur.end + 1 : c->fileEnd;
+    }
+    
+    return NULL;
+}
+
+
+
+// Compares a rebuilt index with the index file, and reports where they differ - the first few
+// lines that do, and how many.
+//
+// Returns: whether they're the same.
+//
+static bool reportDrift(const char * indexFile, const Buffer * built)
+{
+    MappedFile   mf;
+    const char * p;
+    const char * q;
+    const char * pEnd;
+    const char * qEnd    = built->data + built->len;
+    long         line    = 0;
+    long         differ  = 0;
+    long         lines[2] = { 0, 0 };
+    
+    if(!mapFile(indexFile, &mf))
+    {
+        printf("eatshow: %s: there's no index to check\n", indexFile);
+        
+        return false;
+    }
+    
+    p    = mf.base;
+    pEnd = mf.base + mf.size;
+    q    = built->data;
+    
+    while(p < pEnd || q < qEnd)
+    {
+        const char * pl = p < pEnd ? (const char *)memchr(p, '\n', pEnd - p) : NULL;
+        const char * ql = q < qEnd ? (const char *)memchr(q, '\n', qEnd - q) : NULL;
+        
+        size_t pLen = p >= pEnd ? 0 : pl != NULL ? (size_t)(pl - p) : (size_t)(pEnd - p);
+        size_t qLen = q >= qEnd ? 0 : ql != NULL ? (size_t)(ql - q) : (size_t)(qEnd - q);
+        
+        line++;
+        
+        lines[0] += p < pEnd;
+        lines[1] += q < qEnd;
+        
+        if(p >= pEnd || q >= qEnd || pLen != qLen || memcmp(p, q, pLen))
+        {
+            if(++differ <= 5)
+            {
+                printf("eatshow: %s: line %ld\n", indexFile, line);
+                printf("    index: %.*s\n", (int)pLen, p < pEnd ? p : "(none)");
+                printf("    data:  %.*s\n", (int)qLen, q < qEnd ? q : "(none)");
+            }
+        }
+        
+        p = p >= pEnd ? pEnd : p + pLen + 1;
+        q = q >= qEnd ? qEnd : q + qLen + 1;
+    }
+    
+    if(differ > 0)
+    {
+        printf("eatshow: %s: %ld of its %ld lines differ from the %ld the data gives\n", indexFile, differ, lines[0], lines[1]);
+    }
+    
+    unmapFile(&mf);
+    
+    return differ == 0;
+}
+
+
+
+// --build-index: rebuilds an index file from its data file - every record being a headword
+// line followed by a line of 'WORD|count' pairs - with exact totals and offsets.  The file is
+// split into -j chunks (or one per CPU) at line boundaries; a first pass counts each chunk's
+// lines, so each knows where its first headword is, and a second writes each chunk's index
+// lines, which are then joined.  The result is compared with the index file, and replaces it
+// unless 'check' is set (or it's no different).
+//
+// Returns: whether the index file matched the data.
+//
+static bool rebuildIndex(const char * dataFile, const char * indexFile, bool check)
+{
+    MappedFile   mf;
+    IndexChunk * chunks;
+    pthread_t  * threads;
+    Buffer       built;
+    
+    long long start = nowNs();
+    long long pairs = 0;
+    long      records = 0;
+    bool      stray = false;
+    bool      same;
+    int       nchunks = workThreads();
+    int       pass;
+    int       k;
+    
+    if(!mapFile(dataFile, &mf))
+    {
+        fprintf(stderr, "cannot access the file: %s\n", dataFile);
+        
+        exit(1);
+    }
+    
+    if(mf.size < (size_t)nchunks * 65536)
+    {
+        nchunks = mf.size >= 65536 * 2 ? (int)(mf.size / 65536) : 1;
+    }
+    
+    chunks  = (IndexChunk *)calloc(nchunks, sizeof(IndexChunk));
+    threads = (pthread_t *)malloc(nchunks * sizeof(pthread_t));
+    
+    if(chunks == NULL || threads == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    // Each chunk starts just after the newline before its share of the bytes.
+    //
+    for(k = 0; k < nchunks; k++)
+    {
+        const char * s = mf.base + mf.size / nchunks * k;
+        
+        if(k > 0)
+        {
+            const char * nl = (const char *)memchr(s - 1, '\n', mf.base + mf.size - (s - 1));
+            
+            s = nl != NULL ? nl + 1 : mf.base + mf.size;
+            
+            if(s < chunks[k - 1].start)
+            {
+                s = chunks[k - 1].start;
+            }
+        }
+        
+        chunks[k].base    = mf.base;
+        chunks[k].start   = s;
+        chunks[k].fileEnd = mf.base + mf.size;
+        
+        if(k > 0)
+        {
+            chunks[k - 1].end = s;
+        }
+    }
+    
+    chunks[nchunks - 1].end = mf.base + mf.size;
+    
+    for(pass = 0; pass < 2; pass++)
+    {
+        for(k = 0; k < nchunks; k++)
+        {
+            if(pass == 1)
+            {
+                chunks[k].firstLine = k > 0 ? chunks[k - 1].firstLine + chunks[k - 1].lines : 0;
+            }
+            
+            pthread_create(&threads[k], NULL, pass == 0 ? countChunk : indexChunk, &chunks[k]);
+        }
+        
+        for(k = 0; k < nchunks; k++)
+        {
+            pthread_join(threads[k], NULL);
+        }
+    }
+    
+    memset(&built, 0, sizeof(built));
+    
+    for(k = 0; k < nchunks; k++)
+    {
+        bufAppend(&built, chunks[k].out.data, chunks[k].out.len);
+        
+        records += chunks[k].records;
+        pairs   += chunks[k].pairs;
+        stray   |= chunks[k].stray;
+        
+        free(chunks[k].out.data);
+    }
+    
+    printf("eatshow: %s: %ld headwords, %lld associations (%d chunks, %.3fs)%s\n", dataFile, records, pairs, nchunks,
+           (nowNs() - start) / 1e9, stray ? " - the last line has no list, and was left out" : "");
+    
+    same = reportDrift(indexFile, &built);
+    
+    if(same)
+    {
+        printf("eatshow: %s is up to date\n", indexFile);
+    }
+    else if(!check)
+    {
+        char   temp[4096];
+        FILE * fp;
+        
+        snprintf(temp, sizeof(temp), "%s.new", indexFile);
+        
+        if((fp = fopen(temp, "wb")) == NULL || fwrite(built.data, 1, built.len, fp) != built.len || fclose(fp) != 0 || rename(temp, indexFile) != 0)
+        {
+            fprintf(stderr, "eatshow: cannot write %s\n", indexFile);
+            
+            exit(1);
+        }
+        
+        printf("eatshow: %s rebuilt\n", indexFile);
+    }
+    
+    unmapFile(&mf);
+    
+    free(built.data);
+    free(chunks);
+    free(threads);
+    
+    return same;
+}
+
+
+
+// Finds 'cue' in a dataset's index, whichever form that's in.
+//
+// Returns: the index entry for cue, or NULL if it isn't a headword.
+//
+static const IndexEntry * findCue(Dataset * ds, const char * cue)
+{
+    if(ds->paged)
+    {
+        return findPaged(ds, cue);
+    }
+    
+    return lookupIndex(&ds->index, cue);
+}
+
+
+
+// Parses one line of an index file held in memory, exactly as fgets(21) followed by
+// fscanf("%d %d %ld %ld\n") would read it from a FILE.
+//
+// Returns: the number of bytes the line used, or -1 if it couldn't be read.
+//
+static long parseIndexLine(const char * p, const char * end, IndexEntry * e)
+{
+    const char * start = p;
+    
+    long * addresses[2];
+    int  * counts[2];
+    
+    int k;
+    
+    addresses[0] = &e->head_address;
+    addresses[1] = &e->tail_address;
+    counts[0]    = &e->tot_rec;
+    counts[1]    = &e->tot_freq;
+    
+    if(p >= end)
+    {
+        return -1;
+    }
+    
+    // The key - up to 20 chars, stopping after a newline.
+    //
+    for(k = 0; k < 20 && p < end; k++)
+    {
+        e->key[k] = *p;
+        
+        if(*p++ == '\n')
+        {
+            k++;
+            
+            break;
+        }
+    }
+    
+    e->key[k] = '\0';
+    
+    trim(e->key);
+    
+    for(k = 0; k < 4; k++)
+    {
+        long n   = 0;
+        bool neg = false;
+        
+        const char * digits;
+        
+        while(p < end && isspace((unsigned char)*p))
+        {
+            p++;
+        }
+        
+        if(p < end && (*p == '-' || *p == '+'))
+        {
+            neg = *p++ == '-';
+        }
+        
+        for(digits = p; p < end && isdigit((unsigned char)*p); p++)
+        {
+            n = n * 10 + (*p - '0');
+        }
+        
+        if(p == digits)
+        {
+            return -1;
+        }
+        
+        if(k < 2)
+        {
+            *counts[k] = (int)(neg ? -n : n);
+        }
+        else
+        {
+            *addresses[k - 2] = neg ? -n : n;
+        }
+    }
+    
+    while(p < end && isspace((unsigned char)*p))
+    {
+        p++;
+    }
+    
+    return p - start;
+}
+
+
+
+// Sets up the -m mode buffer pool.  It starts with only a few frames, enough to read the
+// indexes through once; sizePool gives it the rest of the budget when that's done.
+//
+static void initPool(long budget)
+{
+    bufferPool.maxFrames = (int)(budget / BLOCKSIZE);
+    
+    if(bufferPool.maxFrames < 4)
+    {
+        bufferPool.maxFrames = 4;
+    }
+    
+    bufferPool.nframes = 4;
+    
+    for(bufferPool.nchains = 1; bufferPool.nchains < bufferPool.maxFrames; bufferPool.nchains <<= 1)
+        ;
+    
+    bufferPool.frames = (Frame *)calloc(bufferPool.maxFrames, sizeof(Frame));
+    bufferPool.chains = (int *)malloc(bufferPool.nchains * sizeof(int));
+    
+    if(bufferPool.frames == NULL || bufferPool.chains == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    // Frames get their block buffers when they're first used.
+    //
+    emptyPool();
+    
+    atexit(reportPool);
+    
+    return;
+}
+
+
+
+// Forgets every block in the buffer pool (keeping the frames' buffers).
+//
+static void emptyPool(void)
+{
+    int i;
+    
+    for(i = 0; i < bufferPool.maxFrames; i++)
+    {
+        bufferPool.frames[i].file = -1;
+        bufferPool.frames[i].next = -1;
+        bufferPool.frames[i].ref  = false;
+    }
+    
+    for(i = 0; i < bufferPool.nchains; i++)
+    {
+        bufferPool.chains[i] = -1;
+    }
+    
+    bufferPool.hand = 0;
+}
+
+
+
+// Gives the buffer pool whatever of the budget the index directories haven't taken (but
+// never less than the few frames it started with), and zeroes its counters.
+//
+static void sizePool(void)
+{
+    long frames = bufferPool.maxFrames - (long)((bufferPool.dirBytes + BLOCKSIZE - 1) / BLOCKSIZE);
+    
+    if(frames > bufferPool.nframes)
+    {
+        bufferPool.nframes = (int)frames;
+    }
+    
+    if(bufferPool.dirBytes > (size_t)bufferPool.maxFrames * BLOCKSIZE)
+    {
+        fprintf(stderr, "eatshow: the index directories alone need %lu bytes - more than -m allows\n", (unsigned long)bufferPool.dirBytes);
+    }
+    
+    bufferPool.hits      = 0;
+    bufferPool.misses    = 0;
+    bufferPool.bytesRead = 0;
+    
+    return;
+}
+
+
+
+// Reports on the buffer pool's use as eatshow exits.  Reading the indexes at startup isn't
+// counted - that's a fixed cost - just the queries.
+//
+static void reportPool(void)
+{
+    long total = bufferPool.hits + bufferPool.misses;
+    
+    fprintf(stderr, "\neatshow: buffer pool: %d x %d byte frames, %lu bytes of directory\n",
+            bufferPool.nframes, BLOCKSIZE, (unsigned long)bufferPool.dirBytes);
+    
+    fprintf(stderr, "eatshow: %ld queries, %ld block hits, %ld misses (%.1f%% hit ratio), %ld bytes read (%.0f per query)\n",
+            bufferPool.queries, bufferPool.hits, bufferPool.misses, total ? 100.0 * bufferPool.hits / total : 0.0,
+            bufferPool.bytesRead, bufferPool.queries ? (double)bufferPool.bytesRead / bufferPool.queries : 0.0);
+    
+    return;
+}
+
+
+
+// Opens a file for reading through the buffer pool.
+//
+// Returns: false if it can't be opened.
+//
+static bool openPaged(const char * name, PagedFile * pf, int id)
+{
+    if((pf->fp = fopen(name, "rb")) == NULL)
+    {
+        return false;
+    }
+    
+    // The pool is the only cache these files get.
+    //
+    setvbuf(pf->fp, NULL, _IONBF, 0);
+    
+    fseek(pf->fp, 0, SEEK_END);
+    
+    pf->size = ftell(pf->fp);
+    pf->id   = id;
+    
+    return true;
+}
+
+
+
+// Gets a block of a file from the buffer pool, reading it in (over the CLOCK's victim) if
+// it's not there.
+//
+// Returns: the block's frame.
+//
+static const Frame * poolBlock(const PagedFile * pf, long block)
+{
+    unsigned int chain = (unsigned int)((pf->id * 0x9E3779B1u) ^ (unsigned int)block) & (bufferPool.nchains - 1);
+    
+    Frame * f;
+    int     i;
+    
+    for(i = bufferPool.chains[chain]; i != -1; i = bufferPool.frames[i].next)
+    {
+        f = &bufferPool.frames[i];
+        
+        if(f->file == pf->id && f->block == block)
+        {
+            f->ref = true;
+            
+            bufferPool.hits++;
+            
+            return f;
+        }
+    }
+    
+    // A miss - sweep for a frame whose reference bit is clear.
+    //
+    for(;;)
+    {
+        f = &bufferPool.frames[bufferPool.hand];
+        
+        i = bufferPool.hand;
+        
+        bufferPool.hand = (bufferPool.hand + 1) % bufferPool.nframes;
+        
+        if(f->file != -1 && f->ref)
+        {
+            f->ref = false;
+            
+            continue;
+        }
+        
+        break;
+    }
+    
+    // Unhook the victim from its old chain.
+    //
+    if(f->file != -1)
+    {
+        int * link = &bufferPool.chains[(unsigned int)((f->file * 0x9E3779B1u) ^ (unsigned int)f->block) & (bufferPool.nchains - 1)];
+        
+        while(*link != i)
+        {
+            link = &bufferPool.frames[*link].next;
+        }
+        
+        *link = f->next;
+    }
+    
+    if(f->data == NULL && (f->data = (char *)malloc(BLOCKSIZE)) == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    fseek(pf->fp, block * BLOCKSIZE, SEEK_SET);
+    
+    tally.syscalls += 2;
+    
+    if(fread(f->data, 1, BLOCKSIZE, pf->fp) == 0)
+    {
+        f->file = -1;
+        
+        return NULL;
+    }
+    
+    f->file  = pf->id;
+    f->block = block;
+    f->ref   = true;
+    f->next  = bufferPool.chains[chain];
+    
+    bufferPool.chains[chain] = i;
+    
+    bufferPool.misses++;
+    bufferPool.bytesRead += BLOCKSIZE;
+    
+    return f;
+}
+
+
+
+// Copies up to len bytes of a PagedFile, from offset 'off', through the buffer pool.
+//
+// Returns: the number of bytes copied (fewer than len at the end of the file).
+//
+static long pagedRead(const PagedFile * pf, long off, char * dst, long len)
+{
+    long done = 0;
+    
+    if(len > pf->size - off)
+    {
+        len = pf->size - off;
+    }
+    
+    while(done < len)
+    {
+        const Frame * f = poolBlock(pf, (off + done) / BLOCKSIZE);
+        
+        long at = (off + done) % BLOCKSIZE;
+        long n  = BLOCKSIZE - at;
+        
+        if(f == NULL)
+        {
+            break;
+        }
+        
+        if(n > len - done)
+        {
+            n = len - done;
+        }
+        
+        memcpy(dst + done, f->data + at, n);
+        
+        done += n;
+    }
+    
+    return done;
+}
+
+
+
+// Orders the words of a PagedIndex directory.
+//
+static int compareDir(const void * a, const void * b)
+{
+    unsigned long long x = *(const unsigned long long *)a;
+    unsigned long long y = *(const unsigned long long *)b;
+    
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+
+
+// Opens a dataset for -m mode.  The index is read through the pool once, to note which
+// block each key is in and where each block's first line starts - nothing else is kept.
+//
+static void openPagedDataset(Dataset * ds, char mode, const char * dataFile, const char * indexFile)
+{
+    PagedIndex * pi = &ds->pindex;
+    
+    long pos = 0;
+    long cap = 0;
+    long i;
+    
+    ds->mode   = mode;
+    ds->paged  = true;
+    
+    if(!openPaged(dataFile, &ds->pdata, mode == 's' ? 0 : 2))
+    {
+        fprintf(stderr, "cannot access the file: %s\n", dataFile);
+        
+        exit(1);
+    }
+    
+    if(!openPaged(indexFile, &pi->file, mode == 's' ? 1 : 3))
+    {
+        fprintf(stderr, "cannot access the file: %s\n", indexFile);
+        
+        exit(1);
+    }
+    
+    pi->nblocks   = (pi->file.size + BLOCKSIZE - 1) / BLOCKSIZE;
+    pi->lineStart = (unsigned short *)malloc((pi->nblocks + 1) * sizeof(unsigned short));
+    
+    if(pi->lineStart == NULL || pi->nblocks >= (1L << 24))
+    {
+        fprintf(stderr, "eatshow: cannot page the file: %s\n", indexFile);
+        
+        exit(1);
+    }
+    
+    for(i = 0; i < pi->nblocks; i++)
+    {
+        pi->lineStart[i] = 0xFFFF;
+    }
+    
+    for(;;)
+    {
+        char window[512];
+        long n = pagedRead(&pi->file, pos, window, sizeof(window));
+        long used;
+        long block = pos / BLOCKSIZE;
+        
+        IndexEntry e;
+        
+        if((used = parseIndexLine(window, window + n, &e)) < 0)
+        {
+            break;
+        }
+        
+        if(pi->lineStart[block] == 0xFFFF)
+        {
+            pi->lineStart[block] = (unsigned short)(pos % BLOCKSIZE);
+        }
+        
+        if(pi->ndir == cap)
+        {
+            cap = cap == 0 ? 1024 : cap * 2;
+            
+            if((pi->dir = (unsigned long long *)realloc(pi->dir, cap * sizeof(unsigned long long))) == NULL)
+            {
+                fprintf(stderr, "eatshow: out of memory\n");
+                
+                exit(1);
+            }
+        }
+        
+        pi->dir[pi->ndir++] = (hashKey(e.key, 0) & ~0xFFFFFFULL) | (unsigned long long)block;
+        
+        pos += used;
+    }
+    
+    pi->end    = pos;
+    ds->length = pi->ndir;
+    pi->dir    = (unsigned long long *)realloc(pi->dir, (pi->ndir + 1) * sizeof(unsigned long long));
+    
+    qsort(pi->dir, pi->ndir, sizeof(unsigned long long), compareDir);
+    
+    bufferPool.dirBytes += pi->ndir * sizeof(unsigned long long) + pi->nblocks * sizeof(unsigned short);
+    
+    return;
+}
+
+
+
+// Searches one block of a paged index for 'cue' - every line that starts in the block.
+//
+// Returns: true (with the entry in pi->found) if cue is there.
+//
+static bool searchBlock(PagedIndex * pi, long block, const char * cue)
+{
+    long pos;
+    
+    if(pi->lineStart[block] == 0xFFFF)
+    {
+        return false;
+    }
+    
+    for(pos = block * BLOCKSIZE + pi->lineStart[block]; pos < (block + 1) * BLOCKSIZE && pos < pi->end; )
+    {
+        char window[512];
+        long n = pagedRead(&pi->file, pos, window, sizeof(window));
+        long used;
+        
+        if((used = parseIndexLine(window, window + n, &pi->found)) < 0)
+        {
+            break;
+        }
+        
+        tally.indexLines++;
+        
+        if(strcmp(pi->found.key, cue) == WORD_FOUND)
+        {
+            return true;
+        }
+        
+        pos += used;
+    }
+    
+    return false;
+}
+
+
+
+// Finds 'cue' in a paged index, searching just the blocks the directory says it could be in
+// (in file order, so the first of a duplicated key is found).
+//
+// Returns: the index entry for cue, or NULL if it isn't a headword.
+//
+static const IndexEntry * findPaged(Dataset * ds, const char * cue)
+{
+    PagedIndex * pi = &ds->pindex;
+    
+    unsigned long long h = hashKey(cue, 0) & ~0xFFFFFFULL;
+    
+    long lo = 0;
+    long hi = pi->ndir;
+    
+    bufferPool.queries++;
+    
+    while(lo < hi)
+    {
+        long mid = (lo + hi) / 2;
+        
+        if(pi->dir[mid] < h)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    
+    for(; lo < pi->ndir && (pi->dir[lo] & ~0xFFFFFFULL) == h; lo++)
+    {
+        // Several keys from one block share a word, so don't search it twice.
+        //
+        if(lo > 0 && pi->dir[lo] == pi->dir[lo - 1])
+        {
+            continue;
+        }
+        
+        if(searchBlock(pi, (long)(pi->dir[lo] & 0xFFFFFF), cue))
+        {
+            return &pi->found;
+        }
+    }
+    
+    return NULL;
+}
+
+
+
+// How many threads a one-off job (--bench, --build-index, --transpose) should use - -j's
+// number, or one per CPU if -j wasn't given.
+//
+static int workThreads(void)
+{
+    int n = nThreads;
+
+#ifndef _WIN32
+    if(n <= 1)
+    {
+        n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+#endif
+    
+    return n < 1 ? 1 : n;
+}
+
+
+
+// Every distinct word, numbered in the order they're first seen - see vocabId.
+//
+typedef struct
+{
+    Buffer               names;          /* the words, one after another                          */
+    unsigned int       * at;             /* word n is at names.data + at[n] ...                   */
+    int                * len;            /* ... and len[n] long                                   */
+    unsigned long long * set;            /* hash << 32 | word number + 1, by hash                 */
+    int                  n;
+    int                  cap;
+    int                  setSize;        /* a power of 2, and more than twice n                   */
+} Vocab;
+
+
+
+// Finds a word's number in a Vocab, numbering it first if it's new and 'add' is set.  The set
+// is open addressed, and a word is only compared with those whose hash has the same top 32
+// bits - the words themselves are kept together in 'names', rather than wherever they were
+// found, so that those comparisons stay in cache.
+//
+// Returns: the word's number, or -1 if it isn't there (and 'add' isn't set).
+//
+static int vocabId(Vocab * v, const char * word, int len, bool add)
+{
+    unsigned long long h   = hashWord(word, len);
+    unsigned long long tag = h >> 32 << 32;
+    
+    // Doubled when half full - the words are rehashed from 'names'.
+    //
+    if(v->n * 2 >= v->setSize)
+    {
+        int i;
+        
+        if(!add)
+        {
+            return -1;
+        }
+        
+        free(v->set);
+        
+        v->setSize = v->setSize == 0 ? 1 << 16 : v->setSize * 2;
+        
+        if((v->set = (unsigned long long *)calloc(v->setSize, sizeof(*v->set))) == NULL)
+        {
+            fprintf(stderr, "eatshow: out of memory\n");
+            
+            exit(1);
+        }
+        
+        for(i = 0; i < v->n; i++)
+        {
+            unsigned long long g = hashWord(v->names.data + v->at[i], v->len[i]);
+            unsigned long long t = g >> 32 << 32;
+            
+            for(g &= v->setSize - 1; v->set[g] != 0; g = (g + 1) & (v->setSize - 1))
+                ;
+            
+            v->set[g] = t | (unsigned int)(i + 1);
+        }
+    }
+    
+    for(h &= v->setSize - 1; v->set[h] != 0; h = (h + 1) & (v->setSize - 1))
+    {
+        int i = (int)(unsigned int)v->set[h] - 1;
+        
+        if((v->set[h] >> 32 << 32) == tag && v->len[i] == len && memcmp(v->names.data + v->at[i], word, len) == 0)
+        {
+            return i;
+        }
+    }
+    
+    if(!add)
+    {
+        return -1;
+    }
+    
+    if(v->n == v->cap)
+    {
+        v->cap = v->cap == 0 ? 4096 : v->cap * 2;
+        
+        if((v->at = (unsigned int *)realloc(v->at, v->cap * sizeof(unsigned int))) == NULL || (v->len = (int *)realloc(v->len, v->cap * sizeof(int))) == NULL)
+        {
+            fprintf(stderr, "eatshow: out of memory\n");
+            
+            exit(1);
+        }
+    }
+    
+    v->at[v->n]  = (unsigned int)v->names.len;
+    v->len[v->n] = len;
+    
+    bufAppend(&v->names, word, len);
+    bufAppend(&v->names, "", 1);
+    
+    v->set[h] = tag | (unsigned int)++v->n;
+    
+    return v->n - 1;
+}
+
+
+
+// Frees everything a Vocab holds.
+//
+static void vocabFree(Vocab * v)
+{
+    free(v->names.data);
+    free(v->at);
+    free(v->len);
+    free(v->set);
+    
+    memset(v, 0, sizeof(*v));
+}
+
+
+
+// One association on its way into the transposed lists - which list it came from, and its
+// count.
+//
+typedef struct
+{
+    int count;
+    int stim;
+} TransPair;
+
+// One thread's share of a transpose: the lists from..to, and where in 'pairs' each column's
+// next pair from them goes.
+//
+typedef struct
+{
+    const int * rowStart;                /* list r's associations are rowStart[r] .. [r + 1]      */
+    const int * col;                     /* each association's column (its response)              */
+    const int * count;
+    const int * colStart;                /* the sort pass: column c's pairs, like rowStart        */
+    TransPair * pairs;                   /* every pair, grouped by column                         */
+    int       * next;                    /* ncols - counts in the first pass, slots in the second */
+    int         from;
+    int         to;
+    int         pass;
+} TransposeWork;
+
+
+
+// Orders a column's pairs as the shipped r-s lists are: most frequent first, and then in the
+// order the stimuli are in the s-r file.
+//
+static int compareTrans(const void * a, const void * b)
+{
+    const TransPair * x = (const TransPair *)a;
+    const TransPair * y = (const TransPair *)b;
+    
+    if(x->count != y->count)
+    {
+        return x->count > y->count ? -1 : 1;
+    }
+    
+    return x->stim < y->stim ? -1 : x->stim > y->stim ? 1 : 0;
+}
+
+
+
+// The transpose's threads - pass 0 counts each column's pairs in this thread's lists, pass 1
+// puts them in their slots, and pass 2 sorts columns from..to.
+//
+static void * transposeRows(void * arg)
+{
+    TransposeWork * w = (TransposeWork *)arg;
+    
+    int r;
+    int a;
+    
+    for(r = w->from; r < w->to; r++)
+    {
+        if(w->pass == 0)
+        {
+            for(a = w->rowStart[r]; a < w->rowStart[r + 1]; a++)
+            {
+                w->next[w->col[a]]++;
+            }
+        }
+        else if(w->pass == 1)
+        {
+            for(a = w->rowStart[r]; a < w->rowStart[r + 1]; a++)
+            {
+                TransPair * p = &w->pairs[w->next[w->col[a]]++];
+                
+                p->count = w->count[a];
+                p->stim  = r;
+            }
+        }
+        else
+        {
+            qsort(w->pairs + w->colStart[r], w->colStart[r + 1] - w->colStart[r], sizeof(TransPair), compareTrans);
+        }
+    }
+    
+    return NULL;
+}
+
+
+
+// Transposes nrows lists, CSR fashion - list r is col[] and count[] from rowStart[r] up to
+// rowStart[r + 1] - into ncols lists of TransPairs, by a counting sort on the columns, on
+// workThreads() threads.  Each thread counts its share of the lists' columns, the counts give
+// every thread its own slots in each column's list, and each fills its slots in row order - so
+// a stable sort by count, which is what the r-s file has, is just a sort on (count, row).
+//
+// Returns: the pairs, grouped by column - column c's are from colStart[c] up to colStart[c + 1]
+// (colStart has ncols + 1 ints).
+//
+static TransPair * transposeCsr(const int * rowStart, const int * col, const int * count, int nrows, int ncols, int * colStart)
+{
+    TransposeWork * work;
+    pthread_t     * threads;
+    TransPair     * pairs;
+    
+    long nassoc = rowStart[nrows];
+    int  nwork  = workThreads();
+    int  pass;
+    int  r;
+    int  t;
+    
+    if(nwork > nrows)
+    {
+        nwork = nrows > 0 ? nrows : 1;
+    }
+    
+    work    = (TransposeWork *)calloc(nwork, sizeof(TransposeWork));
+    threads = (pthread_t *)malloc(nwork * sizeof(pthread_t));
+    pairs   = (TransPair *)malloc((nassoc + 1) * sizeof(TransPair));
+    
+    if(work == NULL || threads == NULL || pairs == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    // Each thread takes an equal share of the associations.
+    //
+    for(t = 0, r = 0; t < nwork; t++)
+    {
+        TransposeWork * w = &work[t];
+        
+        w->rowStart = rowStart;
+        w->col      = col;
+        w->count    = count;
+        w->colStart = colStart;
+        w->pairs    = pairs;
+        w->from     = r;
+        
+        while(r < nrows && (t == nwork - 1 || rowStart[r] < nassoc * (t + 1) / nwork))
+        {
+            r++;
+        }
+        
+        w->to = r;
+        
+        if((w->next = (int *)calloc(ncols + 1, sizeof(int))) == NULL)
+        {
+            fprintf(stderr, "eatshow: out of memory\n");
+            
+            exit(1);
+        }
+    }
+    
+    for(pass = 0; pass < 3; pass++)
+    {
+        // Between the counting and the placing, each thread's counts become its first slots.
+        //
+        if(pass == 1)
+        {
+            long at = 0;
+            
+            for(r = 0; r < ncols; r++)
+            {
+                colStart[r] = (int)at;
+                
+                for(t = 0; t < nwork; t++)
+                {
+                    int n = work[t].next[r];
+                    
+                    work[t].next[r] = (int)at;
+                    
+                    at += n;
+                }
+            }
+            
+            colStart[ncols] = (int)at;
+        }
+        
+        // Sorting, the threads take the columns instead.
+        //
+        if(pass == 2)
+        {
+            for(t = 0; t < nwork; t++)
+            {
+                work[t].from = (int)((long)ncols * t / nwork);
+                work[t].to   = (int)((long)ncols * (t + 1) / nwork);
+            }
+        }
+        
+        for(t = 0; t < nwork; t++)
+        {
+            work[t].pass = pass;
+            
+            pthread_create(&threads[t], NULL, transposeRows, &work[t]);
+        }
+        
+        for(t = 0; t < nwork; t++)
+        {
+            pthread_join(threads[t], NULL);
+        }
+    }
+    
+    for(t = 0; t < nwork; t++)
+    {
+        free(work[t].next);
+    }
+    
+    free(work);
+    free(threads);
+    
+    return pairs;
+}
+
+
+
+// A derived r-s headword - its word and its number.
+//
+typedef struct
+{
+    const char * word;
+    int          len;
+    int          id;
+} TransWord;
+
+static int compareTransWords(const void * a, const void * b)
+{
+    const TransWord * x = (const TransWord *)a;
+    const TransWord * y = (const TransWord *)b;
+    
+    int c = memcmp(x->word, y->word, x->len < y->len ? x->len : y->len);
+    
+    return c != 0 ? c : x->len - y->len;
+}
+
+
+
+// --transpose: derives the r-s direction from the s-r one (loaded from its text files) rather
+// than reading rs_concise and rs_index.  Every response in the s-r lists is numbered, and the
+// lists are transposed on those numbers by transposeCsr.
+//
+// The result is in compiled form, as a snapshot's - SnapAssocs naming the stimuli in a string
+// pool - under an index keyed just as rs_index would be, so lookups find what -r finds in the
+// shipped files.  Headwords are in byte order.
+//
+static void transposeDataset(Dataset * sr, Dataset * rs)
+{
+    const HeadwordIndex * si = &sr->index;
+    
+    TransWord     * words;               /* the responses, to be put in order                     */
+    int           * rowStart;
+    int           * resp    = NULL;
+    int           * count   = NULL;
+    int           * respStart;
+    unsigned int  * stimName;            /* each s-r list's headword, in the pool                 */
+    unsigned int  * stimLen;
+    TransPair     * pairs;
+    SnapAssoc     * assoc;
+    IndexEntry    * all;
+    Buffer          pool;
+    Vocab           vocab;
+    
+    long long start   = nowNs();
+    long      nassoc  = 0;
+    long      cap     = 0;
+    int       nresps;
+    int       nrows   = si->nentries;
+    int       r;
+    
+    memset(&pool, 0, sizeof(pool));
+    memset(&vocab, 0, sizeof(vocab));
+    
+    bufAppend(&pool, "", 1);
+    
+    rowStart = (int *)malloc((nrows + 1) * sizeof(int));
+    stimName = (unsigned int *)malloc((nrows + 1) * sizeof(unsigned int));
+    stimLen  = (unsigned int *)malloc((nrows + 1) * sizeof(unsigned int));
+    
+    if(rowStart == NULL || stimName == NULL || stimLen == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    // Number the responses, in the order they're first seen, and note each s-r list's.
+    //
+    for(r = 0; r < nrows; r++)
+    {
+        const IndexEntry * e = &si->entries[r];
+        const char       * head = e->key;
+        const char       * nl;
+        int                headLen = (int)strlen(e->key);
+        
+        AssocCursor  cur;
+        const char * word;
+        int          wordLen;
+        int          n;
+        
+        // The stimulus as the s-r file has it - the key may have been cut short.
+        //
+        if(e->head_address >= 0 && (size_t)e->head_address < sr->data.size && (nl = (const char *)memchr(sr->data.base + e->head_address, '\n', sr->data.size - e->head_address)) != NULL)
+        {
+            head    = sr->data.base + e->head_address;
+            headLen = (int)(nl - head);
+        }
+        
+        stimName[r] = (unsigned int)pool.len;
+        stimLen[r]  = (unsigned int)headLen;
+        
+        bufAppend(&pool, head, headLen);
+        bufAppend(&pool, "", 1);
+        
+        rowStart[r] = (int)nassoc;
+        
+        if(!openAssoc(sr, e, &cur))
+        {
+            continue;
+        }
+        
+        while(nextAssoc(&cur, &word, &wordLen, &n))
+        {
+            if(nassoc == cap)
+            {
+                cap = cap == 0 ? 65536 : cap * 2;
+                
+                if((resp = (int *)realloc(resp, cap * sizeof(int))) == NULL || (count = (int *)realloc(count, cap * sizeof(int))) == NULL)
+                {
+                    fprintf(stderr, "eatshow: out of memory\n");
+                    
+                    exit(1);
+                }
+            }
+            
+            resp[nassoc]    = vocabId(&vocab, word, wordLen, true);
+            count[nassoc++] = n;
+        }
+    }
+    
+    rowStart[nrows] = (int)nassoc;
+    
+    nresps    = vocab.n;
+    respStart = (int *)malloc((nresps + 1) * sizeof(int));
+    words     = (TransWord *)malloc((nresps + 1) * sizeof(TransWord));
+    
+    if(respStart == NULL || words == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    pairs = transposeCsr(rowStart, resp, count, nrows, nresps, respStart);
+    
+    // The r-s Dataset, its headwords in byte order.
+    //
+    for(r = 0; r < nresps; r++)
+    {
+        words[r].word = vocab.names.data + vocab.at[r];
+        words[r].len  = vocab.len[r];
+        words[r].id   = r;
+    }
+    
+    qsort(words, nresps, sizeof(TransWord), compareTransWords);
+    
+    assoc = (SnapAssoc *)malloc((nassoc + 1) * sizeof(SnapAssoc));
+    all   = (IndexEntry *)calloc(nresps + 1, sizeof(IndexEntry));
+    
+    if(assoc == NULL || all == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    nassoc = 0;
+    
+    for(r = 0; r < nresps; r++)
+    {
+        IndexEntry * e  = &all[r];
+        int          id = words[r].id;
+        int          p;
+        
+        // The key as rs_index would have it - cut to 19 chars and a '%' if it's over 20,
+        // and trimmed.
+        //
+        if(words[r].len > 20)
+        {
+            memcpy(e->key, words[r].word, 19);
+            
+            e->key[19] = '%';
+            e->key[20] = '\0';
+        }
+        else
+        {
+            memcpy(e->key, words[r].word, words[r].len);
+            
+            e->key[words[r].len] = '\0';
+        }
+        
+        trim(e->key);
+        
+        e->first        = (int)nassoc;
+        e->nassoc       = respStart[id + 1] - respStart[id];
+        e->tot_rec      = e->nassoc;
+        e->head_address = r;
+        e->tail_address = r;
+        
+        for(p = respStart[id]; p < respStart[id + 1]; p++)
+        {
+            SnapAssoc * a = &assoc[nassoc++];
+            
+            a->word  = stimName[pairs[p].stim];
+            a->len   = stimLen[pairs[p].stim];
+            a->count = pairs[p].count;
+            
+            e->tot_freq += a->count;
+        }
+    }
+    
+    memset(rs, 0, sizeof(*rs));
+    
+    rs->mode      = 'r';
+    rs->data.base = "";
+    rs->assoc     = assoc;
+    rs->pool      = pool.data;
+    
+    hashIndex(&rs->index, all, nresps);
+    
+    rs->length = rs->index.nentries;
+    
+    if(statsMode != 0)
+    {
+        fprintf(stderr, "eatshow: r-s derived from s-r: %d headwords, %ld associations (%d threads, %.1fms)\n", nresps, nassoc, workThreads(), (nowNs() - start) / 1e6);
+    }
+    
+    vocabFree(&vocab);
+    
+    free(words);
+    free(rowStart);
+    free(resp);
+    free(count);
+    free(respStart);
+    free(stimName);
+    free(stimLen);
+    free(pairs);
+}
+
+
+
+// One direction of the association graph, CSR fashion: node n's associates are nbr[] from
+// start[n] up to start[n + 1], with their counts alongside in count[] (most frequent first),
+// and total[n] is the sum of those counts - the index files' tot_freq.
+//
+// While a data file is being read, the lists are kept in the file's order instead - record k
+// is node[k]'s, from start[k] - until finishGraphDir puts them in node order.
+//
+typedef struct
+{
+    int * start;
+    int * nbr;
+    int * count;
+    int * total;
+    int * node;                          /* while reading: each record's headword                 */
+    long  nedges;
+    long  cap;
+    int   nrecords;
+    int   nheads;                        /* nodes with a list of their own                        */
+    int   duplicates;                    /* records for a headword that already had one, skipped  */
+} GraphDir;
+
+// The whole thesaurus as a graph - every headword and associate in both data files numbered
+// once (so the same word is the same node in either direction), and both directions' lists as
+// arrays of those numbers.  Built by loadGraph, for the queries that walk the associations
+// rather than just looking them up.
+//
+typedef struct
+{
+    Vocab     vocab;                     /* node n is the word vocab.names.data + vocab.at[n]     */
+    GraphDir  dir[2];                    /* [0] is s-r, [1] is r-s                                */
+    int       nnodes;
+    bool      loaded;
+    long long loadNs;
+} Graph;
+
+static Graph graph;
+
+
+
+// Reads one data file's records into a GraphDir, numbering their words in the graph's Vocab.
+// The text is the Dataset's own where it holds it, so it isn't read twice - only a compiled
+// snapshot or -m leaves the file to be mapped here, for as long as this takes.
+//
+static void readGraphDir(GraphDir * g, const Dataset * ds, const char * file)
+{
+    MappedFile         own = { NULL, 0, false };
+    const MappedFile * mf  = &ds->data;
+    const char       * p;
+    const char       * end;
+    int                capRecords = 0;
+    
+    if(mf->size == 0)
+    {
+        if(!mapFile(file, &own))
+    {
+        fprintf(stderr, "cannot access the file: %s\n", file);
+        
+        exit(1);
+    }
+    
+        mf = &own;
+    }
+    
+    p   = mf->base;
+    end = mf->base + mf->size;
+    
+    while(p < end)
+    {
+        const char * nl = (const char *)memchr(p, '\n', end - p);
+        const char * word;
+        int          wordLen;
+        int          count;
+        
+        AssocCursor cur;
+        
+        // A headword needs a list line after it - the last line of sr_concise doesn't have one.
+        //
+        if(nl == NULL || nl + 1 >= end)
+        {
+            break;
+        }
+        
+        if(g->nrecords + 1 >= capRecords)
+        {
+            capRecords = capRecords == 0 ? 4096 : capRecords * 2;
+            
+            if((g->start = (int *)realloc(g->start, capRecords * sizeof(int))) == NULL || (g->node = (int *)realloc(g->node, capRecords * sizeof(int))) == NULL)
+            {
+                fprintf(stderr, "eatshow: out of memory\n");
+                
+                exit(1);
+            }
+        }
+        
+        g->node[g->nrecords]    = vocabId(&graph.vocab, p, (int)(nl - p), true);
+        g->start[g->nrecords++] = (int)g->nedges;
+        
+        startSplit(&cur, nl + 1, end);
+        
+        while(nextPair(&cur, &word, &wordLen, &count))
+        {
+            if(g->nedges == g->cap)
+            {
+                g->cap = g->cap == 0 ? 65536 : g->cap * 2;
+                
+                if((g->nbr = (int *)realloc(g->nbr, g->cap * sizeof(int))) == NULL || (g->count = (int *)realloc(g->count, g->cap * sizeof(int))) == NULL)
+                {
+                    fprintf(stderr, "eatshow: out of memory\n");
+                    
+                    exit(1);
+                }
+            }
+            
+            g->nbr[g->nedges]     = vocabId(&graph.vocab, word, wordLen, true);
+            g->count[g->nedges++] = count;
+        }
+        
+        p = cur.end < end ? cur.end + 1 : end;
+    }
+    
+    if(g->start != NULL)
+    {
+        g->start[g->nrecords] = (int)g->nedges;
+    }
+    
+    if(mf == &own)
+    {
+        unmapFile(&own);
+    }
+}
+
+
+
+// Puts a GraphDir read by readGraphDir in node order, now that every node is numbered.  Where
+// a headword has more than one record the first is kept, as it's the one lookups find.
+//
+static void finishGraphDir(GraphDir * g, int nnodes)
+{
+    int  * rec   = (int *)malloc((nnodes + 1) * sizeof(int));
+    int  * start = (int *)calloc(nnodes + 1, sizeof(int));
+    int  * nbr;
+    int  * count;
+    long   at = 0;
+    int    n;
+    int    k;
+    
+    if(rec == NULL || start == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    for(n = 0; n < nnodes; n++)
+    {
+        rec[n] = -1;
+    }
+    
+    for(k = 0; k < g->nrecords; k++)
+    {
+        if(rec[g->node[k]] < 0)
+        {
+            rec[g->node[k]] = k;
+            
+            g->nheads++;
+        }
+        else
+        {
+            g->duplicates++;
+        }
+    }
+    
+    for(n = 0; n < nnodes; n++)
+    {
+        start[n] = (int)at;
+        
+        if(rec[n] >= 0)
+        {
+            at += g->start[rec[n] + 1] - g->start[rec[n]];
+        }
+    }
+    
+    start[nnodes] = (int)at;
+    
+    nbr      = (int *)malloc((at + 1) * sizeof(int));
+    count    = (int *)malloc((at + 1) * sizeof(int));
+    g->total = (int *)calloc(nnodes + 1, sizeof(int));
+    
+    if(nbr == NULL || count == NULL || g->total == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    for(n = 0; n < nnodes; n++)
+    {
+        int e;
+        
+        if(rec[n] < 0)
+        {
+            continue;
+        }
+        
+        memcpy(nbr + start[n], g->nbr + g->start[rec[n]], (start[n + 1] - start[n]) * sizeof(int));
+        memcpy(count + start[n], g->count + g->start[rec[n]], (start[n + 1] - start[n]) * sizeof(int));
+        
+        for(e = start[n]; e < start[n + 1]; e++)
+        {
+            g->total[n] += count[e];
+        }
+    }
+    
+    free(g->start);
+    free(g->nbr);
+    free(g->count);
+    free(g->node);
+    free(rec);
+    
+    g->start  = start;
+    g->nbr    = nbr;
+    g->count  = count;
+    g->node   = NULL;
+    g->nedges = at;
+}
+
+
+
+// Builds the graph's r-s direction from its s-r one (--transpose) - see transposeCsr.
+//
+static void transposeGraphDir(const GraphDir * sr, GraphDir * rs, int nnodes)
+{
+    TransPair * pairs;
+    int         n;
+    int         e;
+    
+    rs->start = (int *)malloc((nnodes + 1) * sizeof(int));
+    
+    if(rs->start == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    pairs = transposeCsr(sr->start, sr->nbr, sr->count, nnodes, nnodes, rs->start);
+    
+    rs->nedges = sr->nedges;
+    rs->nbr    = (int *)malloc((rs->nedges + 1) * sizeof(int));
+    rs->count  = (int *)malloc((rs->nedges + 1) * sizeof(int));
+    rs->total  = (int *)calloc(nnodes + 1, sizeof(int));
+    
+    if(rs->nbr == NULL || rs->count == NULL || rs->total == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    for(n = 0; n < nnodes; n++)
+    {
+        rs->nheads += rs->start[n + 1] > rs->start[n];
+        
+        for(e = rs->start[n]; e < rs->start[n + 1]; e++)
+        {
+            rs->nbr[e]    = pairs[e].stim;
+            rs->count[e]  = pairs[e].count;
+            rs->total[n] += pairs[e].count;
+        }
+    }
+    
+    free(pairs);
+}
+
+
+
+// Builds the association graph from the data files - sr_concise, and rs_concise too unless
+// --transpose was given, in which case the r-s direction is the s-r one turned around.  Does
+// nothing if that's already been done.
+//
+// Lookups still go through the Engine's Datasets; the graph is only for the queries that walk
+// it.  It's built from the text the Engine has already mapped, though, so the files are only
+// read once.
+//
+static void loadGraph(void)
+{
+    long long start;
+    
+    if(graph.loaded)
+    {
+        return;
+    }
+    
+    loadEngine();
+    
+    start = nowNs();
+    
+    readGraphDir(&graph.dir[0], &engine.sr, dataPath(SRFILE));
+    
+    if(!bTranspose)
+    {
+        readGraphDir(&graph.dir[1], &engine.rs, dataPath(RSFILE));
+    }
+    
+    graph.nnodes = graph.vocab.n;
+    
+    finishGraphDir(&graph.dir[0], graph.nnodes);
+    
+    if(bTranspose)
+    {
+        transposeGraphDir(&graph.dir[0], &graph.dir[1], graph.nnodes);
+    }
+    else
+    {
+        finishGraphDir(&graph.dir[1], graph.nnodes);
+    }
+    
+    graph.loaded = true;
+    graph.loadNs = nowNs() - start;
+}
+
+
+
+// Finds a word's node in the graph.
+//
+// Returns: the node, or -1 if the word isn't in either data file.
+//
+static int graphNode(const char * word)
+{
+    return vocabId(&graph.vocab, word, (int)strlen(word), false);
+}
+
+
+
+// --graph: builds the association graph and reports its size - nodes, each direction's
+// headwords and associations, and the memory it takes - or, given a word, its node.
+//
+static void graphInfo(const char * word)
+{
+    size_t bytes;
+    int    d;
+    
+    loadGraph();
+    
+    if(word != NULL)
+    {
+        char * cue = STRUPR(strdup(word));
+        int    n   = graphNode(cue);
+        
+        if(n < 0)
+        {
+            printf("%s: not found\n", cue);
+            
+            exit(1);
+        }
+        
+        printf("%s: node %d", cue, n);
+        
+        for(d = 0; d < 2; d++)
+        {
+            const GraphDir * g = &graph.dir[d];
+            
+            printf(", %s %d associates (total %d)", d == 0 ? "s-r" : "r-s", g->start[n + 1] - g->start[n], g->total[n]);
+        }
+        
+        printf("\n");
+        
+        free(cue);
+        
+        return;
+    }
+    
+    bytes = graph.vocab.names.len + (size_t)graph.vocab.setSize * sizeof(unsigned long long) + (size_t)graph.nnodes * (sizeof(unsigned int) + sizeof(int));
+    
+    for(d = 0; d < 2; d++)
+    {
+        bytes += (size_t)(graph.nnodes + 1) * 2 * sizeof(int) + (size_t)graph.dir[d].nedges * 2 * sizeof(int);
+    }
+    
+    printf("%d nodes, %.1f MB, built in %.1fms\n", graph.nnodes, bytes / 1048576.0, graph.loadNs / 1e6);
+    
+    for(d = 0; d < 2; d++)
+    {
+        const GraphDir * g = &graph.dir[d];
+        
+        printf("%s: %d headwords, %ld associations", d == 0 ? "s-r" : "r-s", g->nheads, g->nedges);
+        
+        if(g->duplicates > 0)
+        {
+            printf(" (%d repeated headwords - the first list of each is used)", g->duplicates);
+        }
+        
+        printf("\n");
+    }
+}
+
+
+
+// Working space for walking the graph, two per thread (a search from each end) - a slot in
+// each array for every node.  A node's slots only mean anything once visitNode has stamped it
+// with the current query's number, so nothing needs clearing between queries.
+//
+typedef struct
+{
+    double * score;
+    int    * via;                        /* the node it was reached from, -1 for the start        */
+    int    * hops;
+    int    * stamp;                      /* the query that last visited it                        */
+    int    * touched;                    /* the nodes this query has visited, in order            */
+    int      ntouched;
+    int      query;
+    int      size;
+} Walk;
+
+static thread_local Walk walks[2];
+
+// A node and its score, for ordering.
+//
+typedef struct
+{
+    double score;
+    int    node;
+} NodeScore;
+
+
+
+// Starts a new query on one of this thread's Walks, sizing it to the graph first if need be.
+//
+static Walk * startWalk(int k)
+{
+    Walk * w = &walks[k];
+    
+    if(w->size < graph.nnodes)
+    {
+        free(w->score);
+        free(w->via);
+        free(w->hops);
+        free(w->stamp);
+        free(w->touched);
+        
+        w->size    = graph.nnodes;
+        w->score   = (double *)malloc((w->size + 1) * sizeof(double));
+        w->via     = (int *)malloc((w->size + 1) * sizeof(int));
+        w->hops    = (int *)malloc((w->size + 1) * sizeof(int));
+        w->stamp   = (int *)calloc(w->size + 1, sizeof(int));
+        w->touched = (int *)malloc((w->size + 1) * sizeof(int));
+        w->query   = 0;
+        
+        if(w->score == NULL || w->via == NULL || w->hops == NULL || w->stamp == NULL || w->touched == NULL)
+        {
+            fprintf(stderr, "eatshow: out of memory\n");
+            
+            exit(1);
+        }
+    }
+    
+    if(++w->query == INT_MAX)
+    {
+        memset(w->stamp, 0, w->size * sizeof(int));
+        
+        w->query = 1;
+    }
+    
+    w->ntouched = 0;
+    
+    return w;
+}
+
+
+
+// Frees this thread's Walks - for a thread that's about to exit.
+//
+static void freeWalk(void)
+{
+    int k;
+    
+    for(k = 0; k < 2; k++)
+    {
+        free(walks[k].score);
+        free(walks[k].via);
+        free(walks[k].hops);
+        free(walks[k].stamp);
+        free(walks[k].touched);
+    }
+    
+    memset(walks, 0, sizeof(walks));
+}
+
+
+
+// Visits a node on the current query, clearing its slots if it's the first time.
+//
+// Returns: true if this is the first time.
+//
+static bool visitNode(Walk * w, int n)
+{
+    if(w->stamp[n] == w->query)
+    {
+        return false;
+    }
+    
+    w->stamp[n]   = w->query;
+    w->score[n]   = 0;
+    w->via[n]     = -1;
+    w->hops[n]    = 0;
+    
+    w->touched[w->ntouched++] = n;
+    
+    return true;
+}
+
+
+
+// Orders NodeScores best first - ties by node, so the order is the same every time.
+//
+static int compareScores(const void * a, const void * b)
+{
+    const NodeScore * x = (const NodeScore *)a;
+    const NodeScore * y = (const NodeScore *)b;
+    
+    if(x->score != y->score)
+    {
+        return x->score > y->score ? -1 : 1;
+    }
+    
+    return x->node - y->node;
+}
+
+
+
+// The word a node stands for.
+//
+static const char * nodeWord(int n, int * len)
+{
+    *len = graph.vocab.len[n];
+    
+    return graph.vocab.names.data + graph.vocab.at[n];
+}
+
+
+
+// --expand: finds the words 'cue' leads to in up to expandHops associations, each scored by its
+// strongest chain - the product of the chain's proportions (count / tot_freq at each step).
+// Each hop only goes on from the beamWidth best words reached in the one before, and a chain
+// is dropped as soon as its score falls under minScore - which, as lists are most frequent
+// first, ends a list early.
+//
+// Returns: the words reached (cue aside) best first, in 'found' (from the arena), and their
+// number.  *edges is set to the number of associations followed.
+//
+static int expandNode(const GraphDir * g, int cue, NodeScore ** found, long * edges)
+{
+    Walk      * w = startWalk(0);
+    NodeScore * frontier;
+    NodeScore * next;
+    int         nfrontier = 1;
+    int         h;
+    int         i;
+    
+    frontier = (NodeScore *)arenaAlloc(sizeof(NodeScore));
+    
+    visitNode(w, cue);
+    
+    w->score[cue] = 1;
+    
+    frontier[0].score = 1;
+    frontier[0].node  = cue;
+    
+    *edges = 0;
+    
+    for(h = 1; h <= expandHops && nfrontier > 0; h++)
+    {
+        int nnext = 0;
+        
+        for(i = 0; i < nfrontier; i++)
+        {
+            int    u     = frontier[i].node;
+            double scale = g->total[u] > 0 ? frontier[i].score / g->total[u] : 0;
+            int    e;
+            
+            for(e = g->start[u]; e < g->start[u + 1]; e++)
+            {
+                double s = scale * g->count[e];
+                int    v = g->nbr[e];
+                
+                if(s < minScore)
+                {
+                    break;
+                }
+                
+                (*edges)++;
+                
+                if(v == cue || (!visitNode(w, v) && s <= w->score[v]))
+                {
+                    continue;
+                }
+                
+                w->score[v] = s;
+                w->via[v]   = u;
+                w->hops[v]  = h;
+            }
+        }
+        
+        // The next hop goes on from every word whose score this one set (those it found first,
+        // and those it found again more strongly), or the best beamWidth of them.
+        //
+        next = (NodeScore *)arenaAlloc((w->ntouched + 1) * sizeof(NodeScore));
+        
+        for(i = 1; i < w->ntouched; i++)
+        {
+            int v = w->touched[i];
+            
+            if(w->hops[v] == h)
+            {
+                next[nnext].score  = w->score[v];
+                next[nnext++].node = v;
+            }
+        }
+        
+        if(beamWidth > 0 && nnext > beamWidth)
+        {
+            qsort(next, nnext, sizeof(NodeScore), compareScores);
+            
+            nnext = beamWidth;
+        }
+        
+        frontier  = next;
+        nfrontier = nnext;
+    }
+    
+    *found = (NodeScore *)arenaAlloc(w->ntouched * sizeof(NodeScore));
+    
+    for(i = 1; i < w->ntouched; i++)
+    {
+        (*found)[i - 1].score = w->score[w->touched[i]];
+        (*found)[i - 1].node  = w->touched[i];
+    }
+    
+    qsort(*found, w->ntouched - 1, sizeof(NodeScore), compareScores);
+    
+    return w->ntouched - 1;
+}
+
+
+
+// Renders --expand's answer for one cue - the best (-l<n>, or GRAPHTOPK) words it leads to, with
+// how many hops away each is, its score, and the word before it on its strongest chain.
+//
+static bool renderExpansion(const GraphDir * g, char mode, const char * cue, const Layout * layout, Buffer * screen, Buffer * echo)
+{
+    const char * direction = mode == 'r' ? "r-s" : "s-r";
+    const Walk * w     = &walks[0];
+    NodeScore  * found = NULL;
+    long         edges = 0;
+    int          n     = graphNode(cue);
+    int          nfound = 0;
+    int          k     = layout->limited ? layout->limit : GRAPHTOPK;
+    int          i;
+    
+    size_t       begin = screen->len;
+    
+    long long t = statsMode != 0 ? nowNs() : 0;
+    
+    if(n >= 0)
+    {
+        nfound = expandNode(g, n, &found, &edges);
+        
+        tally.found++;
+    }
+    
+    tally.seekNs += lap(&t);
+    
+    if(k > nfound)
+    {
+        k = nfound;
+    }
+    
+    if(layout->format == FORMAT_JSONL)
+    {
+        bufAppend(screen, "{\"cue\":", 7);
+        bufJson(screen, cue, (int)strlen(cue));
+        bufPrintf(screen, ",\"direction\":\"%s\",\"found\":%s,\"hops\":%d", direction, n >= 0 ? "true" : "false", expandHops);
+        
+        if(n >= 0)
+        {
+            bufPrintf(screen, ",\"reached\":%d,\"followed\":%ld,\"expansions\":[", nfound, edges);
+        }
+    }
+    else if(layout->format == FORMAT_CSV && n < 0)
+    {
+        bufCsv(screen, cue, (int)strlen(cue));
+        bufPrintf(screen, ",%s,0,,,,,\n", direction);
+    }
+    else if(layout->format == FORMAT_TEXT)
+    {
+        bufPrintf(screen, "\nExpanding: %s in %s MODE (%d hops)\n\n", cue, mode == 'r' ? "RESPONSE" : "STIMULUS", expandHops);
+        
+        if(n < 0)
+        {
+            bufPrintf(screen, "eatshow: %s: not found\n", cue);
+        }
+        else if(layout->demark)
+        {
+            bufPrintf(screen, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
+        }
+    }
+    
+    for(i = 0; i < k; i++)
+    {
+        int          v    = found[i].node;
+        int          u    = w->via[v];
+        int          len;
+        int          viaLen;
+        const char * word = nodeWord(v, &len);
+        const char * via  = nodeWord(u, &viaLen);
+        size_t       start = screen->len;
+        
+        if(layout->format == FORMAT_JSONL)
+        {
+            bufAppend(screen, i > 0 ? ",{\"word\":" : "{\"word\":", i > 0 ? 9 : 8);
+            bufJson(screen, word, len);
+            bufPrintf(screen, ",\"hops\":%d,\"score\":%.6g,\"via\":", w->hops[v], found[i].score);
+            bufJson(screen, via, viaLen);
+            bufAppend(screen, "}", 1);
+        }
+        else if(layout->format == FORMAT_CSV)
+        {
+            bufCsv(screen, cue, (int)strlen(cue));
+            bufPrintf(screen, ",%s,1,%d,", direction, i + 1);
+            bufCsv(screen, word, len);
+            bufPrintf(screen, ",%d,%.6g,", w->hops[v], found[i].score);
+            bufCsv(screen, via, viaLen);
+            bufAppend(screen, "\n", 1);
+        }
+        else
+        {
+            if(layout->number)
+            {
+                bufPrintf(screen, "%4d: ", i + 1);
+            }
+            else
+            {
+                bufAppend(screen, "      ", 6);
+            }
+            
+            if(layout->tabs)
+            {
+                bufPrintf(screen, "%.*s\t%d\t%.6f", len, word, w->hops[v], found[i].score);
+            }
+            else
+            {
+                bufPrintf(screen, "%-19.*s %3d %9.6f", len, word, w->hops[v], found[i].score);
+            }
+            
+            if(w->hops[v] > 1)
+            {
+                bufPrintf(screen, layout->tabs ? "\t%.*s" : "  (via %.*s)", viaLen, via);
+            }
+            
+            bufAppend(screen, "\n", 1);
+            
+            if(echo != NULL)
+            {
+                bufAppend(echo, screen->data + start, screen->len - start);
+            }
+        }
+        
+        tally.records++;
+    }
+    
+    if(layout->format == FORMAT_JSONL)
+    {
+        bufAppend(screen, n >= 0 ? "]}\n" : "}\n", n >= 0 ? 3 : 2);
+    }
+    else if(layout->format == FORMAT_CSV && n >= 0 && k == 0)
+    {
+        bufCsv(screen, cue, (int)strlen(cue));
+        bufPrintf(screen, ",%s,1,,,,,\n", direction);
+    }
+    else if(layout->format == FORMAT_TEXT && n >= 0)
+    {
+        if(layout->demark)
+        {
+            bufPrintf(screen, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
+        }
+        
+        bufPrintf(screen, "\n\t%d words reached, %ld associations followed\n\n", nfound, edges);
+    }
+    
+    if(echo != NULL && layout->format != FORMAT_TEXT)
+    {
+        bufAppend(echo, screen->data + begin, screen->len - begin);
+    }
+    
+    tally.formatNs += lap(&t);
+    
+    return n >= 0;
+}
+
+
+
+// A binary min-heap of NodeScores, in the arena.
+//
+typedef struct
+{
+    NodeScore * item;
+    int         n;
+    int         cap;
+} Heap;
+
+
+
+// Adds a node to a Heap.
+//
+static void heapPush(Heap * h, double score, int node)
+{
+    int i;
+    
+    if(h->n == h->cap)
+    {
+        int cap = h->cap == 0 ? 256 : h->cap * 2;
+        
+        h->item = (NodeScore *)arenaGrow(h->item, h->cap * sizeof(NodeScore), cap * sizeof(NodeScore));
+        h->cap  = cap;
+    }
+    
+    for(i = h->n++; i > 0 && h->item[(i - 1) / 2].score > score; i = (i - 1) / 2)
+    {
+        h->item[i] = h->item[(i - 1) / 2];
+    }
+    
+    h->item[i].score = score;
+    h->item[i].node  = node;
+}
+
+
+
+// Takes the lowest scoring node off a Heap - which mustn't be empty.
+//
+static NodeScore heapPop(Heap * h)
+{
+    NodeScore top  = h->item[0];
+    NodeScore last = h->item[--h->n];
+    int       i    = 0;
+    
+    for(;;)
+    {
+        int c = 2 * i + 1;
+        
+        if(c >= h->n)
+        {
+            break;
+        }
+        
+        if(c + 1 < h->n && h->item[c + 1].score < h->item[c].score)
+        {
+            c++;
+        }
+        
+        if(last.score <= h->item[c].score)
+        {
+            break;
+        }
+        
+        h->item[i] = h->item[c];
+        
+        i = c;
+    }
+    
+    if(h->n > 0)
+    {
+        h->item[i] = last;
+    }
+    
+    return top;
+}
+
+
+
+// Keeps the best k nodes in a Heap - the worst of them on top, to make way for a better one.
+//
+static void keepBest(Heap * best, int k, double score, int node)
+{
+    if(best->n < k)
+    {
+        heapPush(best, score, node);
+    }
+    else if(k > 0 && score > best->item[0].score)
+    {
+        heapPop(best);
+        heapPush(best, score, node);
+    }
+}
+
+
+
+// The count of the association from u to v, 0 if there isn't one.
+//
+static int edgeCount(const GraphDir * g, int u, int v)
+{
+    int e;
+    
+    for(e = g->start[u]; e < g->start[u + 1]; e++)
+    {
+        if(g->nbr[e] == v)
+        {
+            return g->count[e];
+        }
+    }
+    
+    return 0;
+}
+
+
+
+// --path: the strongest chain of associations from 'from' to 'to' - the one whose proportions
+// (count / tot_freq at each step) have the greatest product, so the least total cost when each
+// step costs -log(proportion).  Dijkstra's search runs forwards from 'from' over fwd's lists
+// and backwards from 'to' over bwd's (the same associations, turned around), each step taken
+// by whichever side is nearer, until the two meet and neither can better the best join.
+//
+// Returns: the chain's nodes, from first to last, in the arena - and its length in *len (0 if
+// there's no chain).  *cost is its cost, and *expanded the nodes the two searches took.
+//
+static int * findPath(const GraphDir * fwd, const GraphDir * bwd, int from, int to, int * len, double * cost, long * expanded)
+{
+    Walk   * w[2];
+    Heap     heap[2];
+    double   best = from == to ? 0 : HUGE_VAL;
+    int      meet = from == to ? from : -1;
+    int    * path;
+    int      n;
+    int      v;
+    
+    w[0] = startWalk(0);
+    w[1] = startWalk(1);
+    
+    memset(heap, 0, sizeof(heap));
+    
+    visitNode(w[0], from);
+    visitNode(w[1], to);
+    
+    heapPush(&heap[0], 0, from);
+    heapPush(&heap[1], 0, to);
+    
+    *expanded = 0;
+    
+    while(heap[0].n > 0 && heap[1].n > 0 && heap[0].item[0].score + heap[1].item[0].score < best)
+    {
+        int              side = heap[0].item[0].score <= heap[1].item[0].score ? 0 : 1;
+        const GraphDir * g    = side == 0 ? fwd : bwd;
+        Walk           * mine = w[side];
+        Walk           * other = w[1 - side];
+        NodeScore        top  = heapPop(&heap[side]);
+        int              u    = top.node;
+        int              e;
+        
+        // Already taken, by a shorter way.
+        //
+        if(top.score > mine->score[u])
+        {
+            continue;
+        }
+        
+        (*expanded)++;
+        
+        for(e = g->start[u]; e < g->start[u + 1]; e++)
+        {
+            int    x     = g->nbr[e];
+            int    stim  = side == 0 ? u : x;     /* where the association starts from */
+            double c;
+            
+            if(fwd->total[stim] <= 0 || g->count[e] <= 0)
+            {
+                continue;
+            }
+            
+            c = top.score - log((double)g->count[e] / fwd->total[stim]);
+            
+            if(visitNode(mine, x) || c < mine->score[x])
+            {
+                mine->score[x] = c;
+                mine->via[x]   = u;
+                mine->hops[x]  = mine->hops[u] + 1;
+                
+                heapPush(&heap[side], c, x);
+            }
+            
+            if(other->stamp[x] == other->query && c + other->score[x] < best)
+            {
+                best = c + other->score[x];
+                meet = x;
+            }
+        }
+    }
+    
+    if(meet < 0)
+    {
+        *len = 0;
+        
+        return NULL;
+    }
+    
+    // From 'from' to where they met, then on to 'to'.
+    //
+    n    = w[0]->hops[meet] + w[1]->hops[meet] + 1;
+    path = (int *)arenaAlloc(n * sizeof(int));
+    
+    for(v = meet, *len = w[0]->hops[meet]; v >= 0; v = w[0]->via[v])
+    {
+        path[(*len)--] = v;
+    }
+    
+    for(v = w[1]->via[meet], *len = w[0]->hops[meet] + 1; v >= 0; v = w[1]->via[v])
+    {
+        path[(*len)++] = v;
+    }
+    
+    *cost = best;
+    
+    return path;
+}
+
+
+
+// Renders --path's answer for one cue - two words, split at a tab or else at the first space.
+// Each step of the chain is listed with its count and proportion.
+//
+static bool renderPath(const GraphDir * fwd, const GraphDir * bwd, char mode, const char * cue, const Layout * layout, Buffer * screen, Buffer * echo)
+{
+    const char * direction = mode == 'r' ? "r-s" : "s-r";
+    const char * split     = strchr(cue, '\t') != NULL ? strchr(cue, '\t') : strchr(cue, ' ');
+    char       * from      = (char *)arenaAlloc(strlen(cue) + 1);
+    const char * to        = "";
+    int        * path      = NULL;
+    int          len       = 0;
+    int          a         = -1;
+    int          b         = -1;
+    int          i;
+    double       cost      = 0;
+    long         expanded  = 0;
+    size_t       begin     = screen->len;
+    
+    long long t = statsMode != 0 ? nowNs() : 0;
+    
+    strcpy(from, cue);
+    
+    if(split != NULL)
+    {
+        from[split - cue] = '\0';
+        
+        to = from + (split - cue) + 1;
+        
+        while(*to == ' ' || *to == '\t')
+        {
+            to++;
+        }
+        
+        a = graphNode(from);
+        b = graphNode(to);
+    }
+    
+    if(a >= 0 && b >= 0)
+    {
+        path = findPath(fwd, bwd, a, b, &len, &cost, &expanded);
+        
+        tally.found += len > 0;
+    }
+    
+    tally.seekNs += lap(&t);
+    
+    if(layout->format == FORMAT_JSONL)
+    {
+        bufAppend(screen, "{\"from\":", 8);
+        bufJson(screen, from, (int)strlen(from));
+        bufAppend(screen, ",\"to\":", 6);
+        bufJson(screen, to, (int)strlen(to));
+        bufPrintf(screen, ",\"direction\":\"%s\",\"found\":%s,\"expanded\":%ld", direction, len > 0 ? "true" : "false", expanded);
+        
+        if(len > 0)
+        {
+            bufPrintf(screen, ",\"hops\":%d,\"score\":%.6g,\"cost\":%.6g,\"path\":[", len - 1, exp(-cost), cost);
+        }
+    }
+    else if(layout->format == FORMAT_CSV && len == 0)
+    {
+        bufCsv(screen, from, (int)strlen(from));
+        bufAppend(screen, ",", 1);
+        bufCsv(screen, to, (int)strlen(to));
+        bufPrintf(screen, ",%s,0,%ld,,,,\n", direction, expanded);
+    }
+    else if(layout->format == FORMAT_TEXT)
+    {
+        if(split != NULL)
+        {
+            bufPrintf(screen, "\nPath: %s to %s in %s MODE\n\n", from, to, mode == 'r' ? "RESPONSE" : "STIMULUS");
+        }
+        
+        if(split == NULL)
+        {
+            bufPrintf(screen, "\neatshow: %s: --path needs two words\n", cue);
+        }
+        else if(a < 0 || b < 0)
+        {
+            bufPrintf(screen, "eatshow: %s: not found\n", a < 0 ? from : to);
+        }
+        else if(len == 0)
+        {
+            bufPrintf(screen, "eatshow: no path from %s to %s (%ld nodes expanded)\n", from, to, expanded);
+        }
+        else if(layout->demark)
+        {
+            bufPrintf(screen, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
+        }
+    }
+    
+    for(i = 0; i < len; i++)
+    {
+        int          count = i > 0 ? edgeCount(fwd, path[i - 1], path[i]) : 0;
+        double       prop  = i > 0 && fwd->total[path[i - 1]] > 0 ? (double)count / fwd->total[path[i - 1]] : 0;
+        int          wordLen;
+        const char * word  = nodeWord(path[i], &wordLen);
+        size_t       start = screen->len;
+        
+        if(layout->format == FORMAT_JSONL)
+        {
+            bufAppend(screen, i > 0 ? ",{\"word\":" : "{\"word\":", i > 0 ? 9 : 8);
+            bufJson(screen, word, wordLen);
+            
+            if(i > 0)
+            {
+                bufPrintf(screen, ",\"count\":%d,\"proportion\":%.6g", count, prop);
+            }
+            
+            bufAppend(screen, "}", 1);
+        }
+        else if(layout->format == FORMAT_CSV)
+        {
+            bufCsv(screen, from, (int)strlen(from));
+            bufAppend(screen, ",", 1);
+            bufCsv(screen, to, (int)strlen(to));
+            bufPrintf(screen, ",%s,1,%ld,%d,", direction, expanded, i);
+            bufCsv(screen, word, wordLen);
+            bufPrintf(screen, i > 0 ? ",%d,%.6g\n" : ",,\n", count, prop);
+        }
+        else
+        {
+            if(layout->number)
+            {
+                bufPrintf(screen, "%4d: ", i);
+            }
+            else
+            {
+                bufAppend(screen, i > 0 ? "   -> " : "      ", 6);
+            }
+            
+            if(i == 0)
+            {
+                bufPrintf(screen, "%.*s\n", wordLen, word);
+            }
+            else if(layout->tabs)
+            {
+                bufPrintf(screen, "%.*s\t%d\t%.4f\n", wordLen, word, count, prop);
+            }
+            else
+            {
+                bufPrintf(screen, "%-19.*s %3d %7.4f\n", wordLen, word, count, prop);
+            }
+            
+            if(echo != NULL)
+            {
+                bufAppend(echo, screen->data + start, screen->len - start);
+            }
+        }
+        
+        tally.records++;
+    }
+    
+    if(layout->format == FORMAT_JSONL)
+    {
+        bufAppend(screen, len > 0 ? "]}\n" : "}\n", len > 0 ? 3 : 2);
+    }
+    else if(layout->format == FORMAT_TEXT && len > 0)
+    {
+        if(layout->demark)
+        {
+            bufPrintf(screen, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
+        }
+        
+        bufPrintf(screen, "\n\t%d hops, score %.6g (cost %.4f), %ld nodes expanded\n\n", len - 1, exp(-cost), cost, expanded);
+    }
+    
+    if(echo != NULL && layout->format != FORMAT_TEXT)
+    {
+        bufAppend(echo, screen->data + begin, screen->len - begin);
+    }
+    
+    tally.formatNs += lap(&t);
+    
+    return len > 0;
+}
+
+
+
+// The association graph set up for --activate's power iteration: each direction's lists turned
+// around, so node v's in-coming associations are from[] from start[v] up to start[v + 1], with
+// weight[] the share of its stimulus's total each one is (count / tot_freq).
+//
+typedef struct
+{
+    int   * start;
+    int   * from;
+    float * weight;
+    bool    built;
+} Spread;
+
+static Spread spread[2];
+
+// activatePower's worker threads, kept for all of a query's iterations rather than started for
+// each: every time round moves on, each does its PullWork's rows and counts itself done.  A
+// round of -1 tells them to finish.
+//
+typedef struct
+{
+    long            round;
+    int             done;
+    int             nworkers;
+    pthread_mutex_t lock;
+    pthread_cond_t  start;               /* round has moved on                                    */
+    pthread_cond_t  finished;            /* done has reached nworkers                             */
+} PullPool;
+
+// One thread's share of an iteration - rows lo to hi of y = (1 - restartProb) * W'x.  diff and
+// dangling come back as the rows' sum of |y - x|, and of y over nodes with no list of their own.
+//
+typedef struct
+{
+    PullPool     * pool;
+    const Spread * sp;
+    const int    * total;
+    const double * x;
+    double       * y;
+    int            lo;
+    int            hi;
+    double         diff;
+    double         dangling;
+} PullWork;
+
+
+
+// Turns both directions of the graph around for --activate's power iteration (see Spread).
+// Does nothing if that's already been done.
+//
+static void loadSpread(void)
+{
+    int d;
+    
+    for(d = 0; d < 2; d++)
+    {
+        const GraphDir * g  = &graph.dir[d];
+        Spread         * sp = &spread[d];
+        TransPair      * pairs;
+        long             e;
+        
+        if(sp->built)
+        {
+            continue;
+        }
+        
+        sp->start  = (int *)malloc((graph.nnodes + 1) * sizeof(int));
+        sp->from   = (int *)malloc((g->nedges + 1) * sizeof(int));
+        sp->weight = (float *)malloc((g->nedges + 1) * sizeof(float));
+        
+        if(sp->start == NULL || sp->from == NULL || sp->weight == NULL)
+        {
+            fprintf(stderr, "eatshow: out of memory\n");
+            
+            exit(1);
+        }
+        
+        pairs = transposeCsr(g->start, g->nbr, g->count, graph.nnodes, graph.nnodes, sp->start);
+        
+        for(e = 0; e < sp->start[graph.nnodes]; e++)
+        {
+            int u = pairs[e].stim;
+            
+            sp->from[e]   = u;
+            sp->weight[e] = g->total[u] > 0 ? (float)((double)pairs[e].count / g->total[u]) : 0;
+        }
+        
+        free(pairs);
+        
+        sp->built = true;
+    }
+}
+
+
+
+// A thread's rows of one --activate iteration - see PullWork.
+//
+static void * pullRows(void * arg)
+{
+    PullWork     * w     = (PullWork *)arg;
+    const Spread * sp    = w->sp;
+    double         keep  = 1 - restartProb;
+    int            v;
+    
+    w->diff     = 0;
+    w->dangling = 0;
+    
+    for(v = w->lo; v < w->hi; v++)
+    {
+        double sum = 0;
+        int    e;
+        
+        for(e = sp->start[v]; e < sp->start[v + 1]; e++)
+        {
+            sum += sp->weight[e] * w->x[sp->from[e]];
+        }
+        
+        w->y[v]  = keep * sum;
+        w->diff += fabs(w->y[v] - w->x[v]);
+        
+        if(w->total[v] <= 0)
+        {
+            w->dangling += w->y[v];
+        }
+    }
+    
+    return NULL;
+}
+
+
+
+// One of activatePower's worker threads - see PullPool.
+//
+static void * pullThread(void * arg)
+{
+    PullWork * w    = (PullWork *)arg;
+    PullPool * pool = w->pool;
+    long       seen = 0;
+    
+    for(;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        
+        while(pool->round == seen)
+        {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        
+        seen = pool->round;
+        
+        pthread_mutex_unlock(&pool->lock);
+        
+        if(seen < 0)
+        {
+            return NULL;
+        }
+        
+        pullRows(w);
+        
+        pthread_mutex_lock(&pool->lock);
+        
+        if(++pool->done == pool->nworkers)
+        {
+            pthread_cond_broadcast(&pool->finished);
+        }
+        
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+
+
+// Personalized PageRank by power iteration: x = restartProb * s + (1 - restartProb) * W'x, where
+// s shares 1 between the seeds and W is the association lists' proportions - each step spreads
+// a word's activation over its associates as they share its tot_freq, and a restartProb share of
+// it all goes back to the seeds.  Words with no list (responses never used as a stimulus) pass
+// theirs back to the seeds too, so it always sums to 1.  Stops when an iteration changes it by
+// less than tolerance in all (L1), or after MAXITERATIONS.
+//
+// Each iteration's rows are shared between workThreads() threads (but not for a -j batch,
+// whose threads already have a query each), in shares of about equal associations.  This
+// thread does the first share, and the rest are done by a PullPool's, started once.
+//
+// Returns: the activation, in walks[0].score or walks[1].score.  *steps is set to the number
+// of iterations, and *residual to the last one's change.
+//
+static double * activatePower(int d, const int * seeds, int nseeds, long * steps, double * residual)
+{
+    const Spread * sp      = &spread[d];
+    const int    * total   = graph.dir[d].total;
+    double       * x       = startWalk(0)->score;
+    double       * y       = startWalk(1)->score;
+    long           nassoc  = sp->start[graph.nnodes];
+    int            nwork   = bBatchThread ? 1 : workThreads();
+    double         dangling = 0;
+    double         share   = 1.0 / nseeds;
+    PullPool       pool;
+    PullWork     * work;
+    pthread_t    * threads;
+    int            i;
+    int            t;
+    int            v;
+    
+    if(nwork > 1 + nassoc / 65536)
+    {
+        nwork = (int)(1 + nassoc / 65536);
+    }
+    
+#ifdef _WIN32
+    // A worker would wait for rounds that can't come, where 'threads' run as they're started.
+    //
+    nwork = 1;
+#endif
+    
+    work    = (PullWork *)arenaAlloc(nwork * sizeof(PullWork));
+    threads = (pthread_t *)arenaAlloc(nwork * sizeof(pthread_t));
+    
+    pool.round    = 0;
+    pool.done     = 0;
+    pool.nworkers = nwork - 1;
+    
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.start, NULL);
+    pthread_cond_init(&pool.finished, NULL);
+    
+    for(t = 0, v = 0; t < nwork; t++)
+    {
+        work[t].pool  = &pool;
+        work[t].sp    = sp;
+        work[t].total = total;
+        work[t].lo    = v;
+        
+        while(v < graph.nnodes && (t == nwork - 1 || sp->start[v] < nassoc * (t + 1) / nwork))
+        {
+            v++;
+        }
+        
+        work[t].hi = v;
+    }
+    
+    for(t = 1; t < nwork; t++)
+    {
+        pthread_create(&threads[t], NULL, pullThread, &work[t]);
+    }
+    
+    memset(x, 0, graph.nnodes * sizeof(double));
+    
+    for(i = 0; i < nseeds; i++)
+    {
+        x[seeds[i]] += share;
+    }
+    
+    for(i = 0; i < nseeds; i++)
+    {
+        dangling += total[seeds[i]] <= 0 ? share : 0;
+    }
+    
+    *residual = 1;
+    
+    for(*steps = 0; *steps < MAXITERATIONS && *residual >= tolerance; (*steps)++)
+    {
+        double   restart = restartProb + (1 - restartProb) * dangling;
+        double * swap;
+        
+        pthread_mutex_lock(&pool.lock);
+        
+        for(t = 0; t < nwork; t++)
+        {
+            work[t].x = x;
+            work[t].y = y;
+        }
+            
+        pool.done = 0;
+        pool.round++;
+        
+        pthread_cond_broadcast(&pool.start);
+        pthread_mutex_unlock(&pool.lock);
+        
+        pullRows(&work[0]);
+        
+        pthread_mutex_lock(&pool.lock);
+        
+        while(pool.done < pool.nworkers)
+            {
+            pthread_cond_wait(&pool.finished, &pool.lock);
+            }
+        
+        pthread_mutex_unlock(&pool.lock);
+        
+        *residual = 0;
+        dangling  = 0;
+        
+        for(t = 0; t < nwork; t++)
+        {
+            *residual += work[t].diff;
+            dangling  += work[t].dangling;
+        }
+        
+        // Then what goes back to the seeds, correcting the sums for them.
+        //
+        for(i = 0; i < nseeds; i++)
+        {
+            int s = seeds[i];
+            
+            *residual -= fabs(y[s] - x[s]);
+            
+            y[s] += restart * share;
+            
+            *residual += fabs(y[s] - x[s]);
+            dangling  += total[s] <= 0 ? restart * share : 0;
+        }
+        
+        swap = x;
+        x    = y;
+        y    = swap;
+    }
+    
+    pthread_mutex_lock(&pool.lock);
+    
+    pool.round = -1;
+    
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+    
+    for(t = 1; t < nwork; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.start);
+    pthread_cond_destroy(&pool.finished);
+    
+    return x;
+}
+
+
+
+// The same as activatePower, by pushing instead.  Each word has an activation and a residual,
+// all the seeds' to begin with.  Pushing a word moves restartProb of its residual into its
+// activation and spreads the rest over its associates' residuals, by their proportions.
+//
+// The words are swept in order, each pushed in place - so what it passes on can be pushed
+// again later in the same sweep - if its residual is at least the sweep's limit per associate.
+// The limit is one global figure, what's left unspread in all over the number of associations,
+// so each sweep pushes the words holding more than their share and skips the rest, and it
+// falls as the residual does, with nothing to requeue.  Sweeps go on until what's left
+// unspread is less than tolerance in all.  Pushing ahead of the sweep, rather than from last
+// sweep's figures as activatePower does, it gets there in fewer passes.
+//
+// Words with no list should send what they don't keep back to the seeds, to spread all over
+// again.  Instead it's dropped, and the answer scaled up to make up for it at the end: what a
+// seed spreads is always the same shape, so if a share D of it is sent back, the whole is the
+// dropped-for version times 1 + D + D^2 ... = 1 / (1 - D).
+//
+// Returns: the activation, in walks[0].score.  *steps is set to the number of pushes, and
+// *residual to the activation still unspread.
+//
+static double * activatePush(int d, const int * seeds, int nseeds, long * steps, double * residual)
+{
+    const GraphDir * g       = &graph.dir[d];
+    double         * p       = startWalk(0)->score;
+    double         * r       = startWalk(1)->score;
+    double           keep    = 1 - restartProb;
+    double           dropped = 0;
+    double           scale   = 1;
+    double           left    = 1;
+    long             sweeps;
+    int              u;
+    
+    memset(p, 0, graph.nnodes * sizeof(double));
+    memset(r, 0, graph.nnodes * sizeof(double));
+    
+    for(u = 0; u < nseeds; u++)
+    {
+        r[seeds[u]] += 1.0 / nseeds;
+    }
+    
+    *steps = 0;
+    
+    for(sweeps = 0; sweeps < MAXITERATIONS && left * scale >= tolerance; sweeps++)
+    {
+        double limit = left / (g->nedges + 1);
+        
+        for(u = 0; u < graph.nnodes; u++)
+        {
+            double ru = r[u];
+            double rest;
+            int    e;
+            
+            if(ru == 0)
+            {
+                continue;
+            }
+            
+            if(g->total[u] <= 0)
+            {
+                p[u]    += restartProb * ru;
+                dropped += keep * ru;
+                r[u]     = 0;
+            
+                continue;
+            }
+            
+            if(ru < limit * (g->start[u + 1] - g->start[u]))
+            {
+                continue;
+            }
+            
+            rest = keep * ru / g->total[u];
+            
+            r[u]  = 0;
+            p[u] += restartProb * ru;
+            
+            for(e = g->start[u]; e < g->start[u + 1]; e++)
+            {
+                r[g->nbr[e]] += rest * g->count[e];
+            }
+            
+            (*steps)++;
+        }
+        
+        scale = 1 / (1 - dropped);
+        left  = 0;
+        
+        for(u = 0; u < graph.nnodes; u++)
+        {
+            left += r[u];
+            }
+        }
+        
+    *residual = left * scale;
+        
+    for(u = 0; u < graph.nnodes; u++)
+        {
+        p[u] *= scale;
+        }
+        
+    return p;
+}
+
+
+
+// Renders --activate's answer for one cue - a seed word, or several split at commas or spaces.
+// The best (-l<n>, or GRAPHTOPK) words other than the seeds are listed with their activation.
+// With --push one seed is pushed (activatePush); otherwise it's iterated (activatePower).  Push
+// isn't the default as on this graph it's no quicker, and power iteration can use every CPU.
+//
+static bool renderActivation(int d, char mode, const char * cue, const Layout * layout, Buffer * screen, Buffer * echo)
+{
+    const char * direction = mode == 'r' ? "r-s" : "s-r";
+    char       * words     = (char *)arenaAlloc(strlen(cue) + 1);
+    int        * seeds     = (int *)arenaAlloc((strlen(cue) / 2 + 1) * sizeof(int));
+    const char * missing   = NULL;
+    const int  * nodes     = NULL;
+    double     * score     = NULL;
+    char       * word;
+    int          nseeds    = 0;
+    int          nnodes    = 0;
+    int          nactive   = 0;
+    int          k         = layout->limited ? layout->limit : GRAPHTOPK;
+    long         steps     = 0;
+    double       residual  = 0;
+    bool         push      = false;
+    int          i;
+    
+    Heap         best;
+    size_t       begin = screen->len;
+    
+    long long t = statsMode != 0 ? nowNs() : 0;
+    
+    strcpy(words, cue);
+    
+    for(word = words; *(word += strspn(word, ", \t")) != '\0'; )
+    {
+        size_t len  = strcspn(word, ", \t");
+        bool   more = word[len] != '\0';
+        
+        word[len] = '\0';
+        
+        if((seeds[nseeds++] = graphNode(word)) < 0 && missing == NULL)
+        {
+            missing = word;
+        }
+        
+        word += len + more;
+    }
+    
+    memset(&best, 0, sizeof(best));
+    
+    if(nseeds > 0 && missing == NULL)
+    {
+        push = nseeds == 1 && bPush;
+        
+        score  = push ? activatePush(d, seeds, nseeds, &steps, &residual) : activatePower(d, seeds, nseeds, &steps, &residual);
+            nnodes = graph.nnodes;
+        
+        for(i = 0; i < nnodes; i++)
+        {
+            int  v    = nodes != NULL ? nodes[i] : i;
+            bool seed = false;
+            int  s;
+            
+            for(s = 0; s < nseeds; s++)
+            {
+                seed |= seeds[s] == v;
+            }
+            
+            if(score[v] <= 0 || seed)
+            {
+                continue;
+            }
+            
+            nactive++;
+            
+            keepBest(&best, k, score[v], v);
+        }
+        
+        if(best.n > 1)
+        {
+            qsort(best.item, best.n, sizeof(NodeScore), compareScores);
+        }
+        
+        tally.found++;
+    }
+    
+    tally.seekNs += lap(&t);
+    
+    if(layout->format == FORMAT_JSONL)
+    {
+        bufAppend(screen, "{\"cue\":", 7);
+        bufJson(screen, cue, (int)strlen(cue));
+        bufPrintf(screen, ",\"direction\":\"%s\",\"found\":%s", direction, score != NULL ? "true" : "false");
+        
+        if(score != NULL)
+        {
+            bufPrintf(screen, ",\"method\":\"%s\",\"steps\":%ld,\"residual\":%.3g,\"activated\":%d,\"activations\":[", push ? "push" : "power", steps, residual, nactive);
+        }
+    }
+    else if(layout->format == FORMAT_CSV && score == NULL)
+    {
+        bufCsv(screen, cue, (int)strlen(cue));
+        bufPrintf(screen, ",%s,0,,,\n", direction);
+    }
+    else if(layout->format == FORMAT_TEXT)
+    {
+        bufPrintf(screen, "\nActivating: %s in %s MODE\n\n", cue, mode == 'r' ? "RESPONSE" : "STIMULUS");
+        
+        if(score == NULL)
+        {
+            bufPrintf(screen, "eatshow: %s: not found\n", missing != NULL ? missing : cue);
+        }
+        else if(layout->demark)
+        {
+            bufPrintf(screen, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
+        }
+    }
+    
+    for(i = 0; i < best.n; i++)
+    {
+        int          len;
+        const char * name  = nodeWord(best.item[i].node, &len);
+        size_t       start = screen->len;
+        
+        if(layout->format == FORMAT_JSONL)
+        {
+            bufAppend(screen, i > 0 ? ",{\"word\":" : "{\"word\":", i > 0 ? 9 : 8);
+            bufJson(screen, name, len);
+            bufPrintf(screen, ",\"score\":%.6g}", best.item[i].score);
+        }
+        else if(layout->format == FORMAT_CSV)
+        {
+            bufCsv(screen, cue, (int)strlen(cue));
+            bufPrintf(screen, ",%s,1,%d,", direction, i + 1);
+            bufCsv(screen, name, len);
+            bufPrintf(screen, ",%.6g\n", best.item[i].score);
+        }
+        else
+        {
+            if(layout->number)
+            {
+                bufPrintf(screen, "%4d: ", i + 1);
+            }
+            else
+            {
+                bufAppend(screen, "      ", 6);
+            }
+            
+            if(layout->tabs)
+            {
+                bufPrintf(screen, "%.*s\t%.6f\n", len, name, best.item[i].score);
+            }
+            else
+            {
+                bufPrintf(screen, "%-19.*s %9.6f\n", len, name, best.item[i].score);
+            }
+            
+            if(echo != NULL)
+            {
+                bufAppend(echo, screen->data + start, screen->len - start);
+            }
+        }
+        
+        tally.records++;
+    }
+    
+    if(layout->format == FORMAT_JSONL)
+    {
+        bufAppend(screen, score != NULL ? "]}\n" : "}\n", score != NULL ? 3 : 2);
+    }
+    else if(layout->format == FORMAT_CSV && score != NULL && best.n == 0)
+    {
+        bufCsv(screen, cue, (int)strlen(cue));
+        bufPrintf(screen, ",%s,1,,,\n", direction);
+    }
+    else if(layout->format == FORMAT_TEXT && score != NULL)
+    {
+        if(layout->demark)
+        {
+            bufPrintf(screen, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
+        }
+        
+        bufPrintf(screen, "\n\t%d words activated, %ld %s, residual %.2g\n\n", nactive, steps, push ? "pushes" : "iterations", residual);
+    }
+    
+    if(echo != NULL && layout->format != FORMAT_TEXT)
+    {
+        bufAppend(echo, screen->data + begin, screen->len - begin);
+    }
+    
+    tally.formatNs += lap(&t);
+    
+    return score != NULL;
+}
+
+
+
+// Works out the norm of every list in both directions of the graph, as proportions - for
+// --similar's cosines.  Does nothing if that's already been done.
+//
+static void loadNorms(void)
+{
+    int d;
+    int n;
+    
+    for(d = 0; d < 2 && rowNorm[d] == NULL; d++)
+    {
+        const GraphDir * g = &graph.dir[d];
+        
+        if((rowNorm[d] = (double *)malloc((graph.nnodes + 1) * sizeof(double))) == NULL)
+        {
+            fprintf(stderr, "eatshow: out of memory\n");
+            
+            exit(1);
+        }
+        
+        for(n = 0; n < graph.nnodes; n++)
+        {
+            double sum = 0;
+            int    e;
+            
+            for(e = g->start[n]; e < g->start[n + 1]; e++)
+            {
+                sum += (double)g->count[e] * g->count[e];
+            }
+            
+            rowNorm[d][n] = g->total[n] > 0 ? sqrt(sum) / g->total[n] : 0;
+        }
+    }
+}
+
+
+
+// --similar: scores every headword whose list shares an associate with the cue's, by how alike
+// the two lists are as distributions (each count / tot_freq) - see --metric.  Only the lists that
+// share one are ever looked at: for each of the cue's associates, the other direction's list for
+// it is the headwords it's on the list of, with their counts, so walking those adds up each one's
+// share of the sums.  Any part of the metric that needs the whole of a list (a cosine's norm,
+// Jensen-Shannon's unshared mass) is worked out from the totals at the end.
+//
+// Returns: the number of headwords scored - walks[0].touched, with their similarity in score and
+// shared associates in hops.  *postings is set to the number of list entries walked.
+//
+static int scoreSimilar(int d, int cue, long * postings)
+{
+    const GraphDir * g     = &graph.dir[d];
+    const GraphDir * post  = &graph.dir[1 - d];
+    Walk           * w     = startWalk(0);
+    Walk           * mass  = startWalk(1);   /* Jensen-Shannon: the shared p + q             */
+    double           total = g->total[cue];
+    int              e;
+    int              i;
+    
+    *postings = 0;
+    
+    for(e = g->start[cue]; e < g->start[cue + 1]; e++)
+    {
+        int    r = g->nbr[e];
+        double p = g->count[e] / total;
+        int    f;
+        
+        *postings += post->start[r + 1] - post->start[r];
+        
+        for(f = post->start[r]; f < post->start[r + 1]; f++)
+        {
+            int    s = post->nbr[f];
+            double q;
+            
+            if(s == cue || g->total[s] <= 0)
+            {
+                continue;
+            }
+            
+            q = (double)post->count[f] / g->total[s];
+            
+            if(visitNode(w, s))
+            {
+                visitNode(mass, s);
+            }
+            
+            w->hops[s]++;
+            
+            if(similarity == METRIC_COSINE)
+            {
+                w->score[s] += p * q;
+            }
+            else if(similarity == METRIC_JACCARD)
+            {
+                w->score[s] += p < q ? p : q;
+            }
+            else
+            {
+                w->score[s]    += 0.5 * (p * log(2 * p / (p + q)) + q * log(2 * q / (p + q)));
+                mass->score[s] += p + q;
+            }
+        }
+    }
+    
+    // Cosine: the dot product over the norms.  Jaccard (weighted): the sum of the smaller
+    // proportions over the sum of the larger, which is 2 less the smaller as each sums to 1.
+    // Jensen-Shannon: what's unshared adds half its mass times log 2, and 1 - JS / log 2 is
+    // the similarity.
+    //
+    for(i = 0; i < w->ntouched; i++)
+    {
+        int s = w->touched[i];
+        
+        if(similarity == METRIC_COSINE)
+        {
+            w->score[s] /= rowNorm[d][cue] * rowNorm[d][s];
+        }
+        else if(similarity == METRIC_JACCARD)
+        {
+            w->score[s] /= 2 - w->score[s];
+        }
+        else
+        {
+            w->score[s] = 1 - (w->score[s] + 0.5 * log(2.0) * (2 - mass->score[s])) / log(2.0);
+        }
+    }
+    
+    return w->ntouched;
+}
+
+
+
+// Renders --similar's answer for one cue - the best (-l<n>, or GRAPHTOPK) headwords by how alike
+// their lists are to the cue's, with the similarity and the number of associates they share.
+//
+static bool renderSimilar(int d, char mode, const char * cue, const Layout * layout, Buffer * screen, Buffer * echo)
+{
+    const char * direction = mode == 'r' ? "r-s" : "s-r";
+    const char * metric    = metricNames[similarity];
+    const Walk * w         = &walks[0];
+    int          n         = graphNode(cue);
+    int          k         = layout->limited ? layout->limit : GRAPHTOPK;
+    int          nscored   = 0;
+    long         postings  = 0;
+    bool         found     = n >= 0 && graph.dir[d].total[n] > 0;
+    int          i;
+    
+    Heap         best;
+    size_t       begin = screen->len;
+    
+    long long t = statsMode != 0 ? nowNs() : 0;
+    
+    memset(&best, 0, sizeof(best));
+    
+    if(found)
+    {
+        nscored = scoreSimilar(d, n, &postings);
+        
+        for(i = 0; i < nscored; i++)
+        {
+            keepBest(&best, k, w->score[w->touched[i]], w->touched[i]);
+        }
+        
+        if(best.n > 1)
+        {
+            qsort(best.item, best.n, sizeof(NodeScore), compareScores);
+        }
+        
+        tally.found++;
+    }
+    
+    tally.seekNs += lap(&t);
+    
+    if(layout->format == FORMAT_JSONL)
+    {
+        bufAppend(screen, "{\"cue\":", 7);
+        bufJson(screen, cue, (int)strlen(cue));
+        bufPrintf(screen, ",\"direction\":\"%s\",\"found\":%s,\"metric\":\"%s\"", direction, found ? "true" : "false", metric);
+        
+        if(found)
+        {
+            bufPrintf(screen, ",\"scored\":%d,\"postings\":%ld,\"similar\":[", nscored, postings);
+        }
+    }
+    else if(layout->format == FORMAT_CSV && !found)
+    {
+        bufCsv(screen, cue, (int)strlen(cue));
+        bufPrintf(screen, ",%s,0,%s,,,,\n", direction, metric);
+    }
+    else if(layout->format == FORMAT_TEXT)
+    {
+        bufPrintf(screen, "\nSimilar to: %s in %s MODE (%s)\n\n", cue, mode == 'r' ? "RESPONSE" : "STIMULUS", metric);
+        
+        if(!found)
+        {
+            bufPrintf(screen, "eatshow: %s: not found\n", cue);
+        }
+        else if(layout->demark)
+        {
+            bufPrintf(screen, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
+        }
+    }
+    
+    for(i = 0; i < best.n; i++)
+    {
+        int          v     = best.item[i].node;
+        int          len;
+        const char * word  = nodeWord(v, &len);
+        size_t       start = screen->len;
+        
+        if(layout->format == FORMAT_JSONL)
+        {
+            bufAppend(screen, i > 0 ? ",{\"word\":" : "{\"word\":", i > 0 ? 9 : 8);
+            bufJson(screen, word, len);
+            bufPrintf(screen, ",\"score\":%.6g,\"shared\":%d}", best.item[i].score, w->hops[v]);
+        }
+        else if(layout->format == FORMAT_CSV)
+        {
+            bufCsv(screen, cue, (int)strlen(cue));
+            bufPrintf(screen, ",%s,1,%s,%d,", direction, metric, i + 1);
+            bufCsv(screen, word, len);
+            bufPrintf(screen, ",%.6g,%d\n", best.item[i].score, w->hops[v]);
+        }
+        else
+        {
+            if(layout->number)
+            {
+                bufPrintf(screen, "%4d: ", i + 1);
+            }
+            else
+            {
+                bufAppend(screen, "      ", 6);
+            }
+            
+            if(layout->tabs)
+            {
+                bufPrintf(screen, "%.*s\t%.6f\t%d\n", len, word, best.item[i].score, w->hops[v]);
+            }
+            else
+            {
+                bufPrintf(screen, "%-19.*s %9.6f %3d\n", len, word, best.item[i].score, w->hops[v]);
+            }
+            
+            if(echo != NULL)
+            {
+                bufAppend(echo, screen->data + start, screen->len - start);
+            }
+        }
+        
+        tally.records++;
+    }
+    
+    if(layout->format == FORMAT_JSONL)
+    {
+        bufAppend(screen, found ? "]}\n" : "}\n", found ? 3 : 2);
+    }
+    else if(layout->format == FORMAT_CSV && found && best.n == 0)
+    {
+        bufCsv(screen, cue, (int)strlen(cue));
+        bufPrintf(screen, ",%s,1,%s,,,,\n", direction, metric);
+    }
+    else if(layout->format == FORMAT_TEXT && found)
+    {
+        if(layout->demark)
+        {
+            bufPrintf(screen, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n");
+        }
+        
+        bufPrintf(screen, "\n\t%d headwords scored, %ld list entries walked\n\n", nscored, postings);
+    }
+    
+    if(echo != NULL && layout->format != FORMAT_TEXT)
+    {
+        bufAppend(echo, screen->data + begin, screen->len - begin);
+    }
+    
+    tally.formatNs += lap(&t);
+    
+    return found;
+}
+
+
+
+// Answers a cue by walking the graph, as --expand (and the like) ask, rather than by looking it
+// up - in the current direction.  The Arena is given back afterwards.
+//
+// Returns: true if the cue is in the graph.
+//
+static bool renderGraph(char mode, const char * cue, const Layout * layout, Buffer * screen, Buffer * echo)
+{
+    const GraphDir * g    = &graph.dir[mode == 'r' ? 1 : 0];
+    const GraphDir * back = &graph.dir[mode == 'r' ? 0 : 1];
+    
+    ArenaMark mark = arenaMark();
+    
+    bool found = false;
+    
+    if(graphQuery == GRAPH_EXPAND)
+    {
+        found = renderExpansion(g, mode, cue, layout, screen, echo);
+    }
+    else if(graphQuery == GRAPH_PATH)
+    {
+        found = renderPath(g, back, mode, cue, layout, screen, echo);
+    }
+    else if(graphQuery == GRAPH_ACTIVATE)
+    {
+        found = renderActivation(mode == 'r' ? 1 : 0, mode, cue, layout, screen, echo);
+    }
+    else if(graphQuery == GRAPH_SIMILAR)
+    {
+        found = renderSimilar(mode == 'r' ? 1 : 0, mode, cue, layout, screen, echo);
+    }
+    
+    arenaRelease(mark);
+    
+    return found;
+}
+
+
+
+// Hashes a word that isn't '\0' terminated, as hashKey does (seed 0) - for sets of words
+// masked to a power of 2, where plain FNV's low bits would pile up.
+//
+static unsigned long long hashWord(const char * word, int len)
+{
+    unsigned long long h = 14695981039346656037ULL;
+    int                k;
+    
+    for(k = 0; k < len; k++)
+    {
+        h ^= (unsigned char)word[k];
+        h *= 1099511628211ULL;
+    }
+    
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    
+    return h;
+}
+
+
+
+// Hashes a key for the headword index - 64 bit FNV-1a, with 'seed' folded into the offset
+// basis, followed by a final avalanche so that 'h % n' is usable for any n.
+//
+static unsigned long long hashKey(const char * key, unsigned int seed)
+{
+    unsigned long long h = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+    
+    while(*key)
+    {
+        h ^= (unsigned char)*key++;
+        h *= 1099511628211ULL;
+    }
+    
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    
+    return h;
+}
+
+
+
+// Reads an index file and builds a minimal perfect hash of its headwords.  The file is parsed
+// exactly as the old linear search did, so the same keys are found - where a trimmed key is
+// duplicated, the first occurrence in the file wins.
+//
+static void buildIndex(HeadwordIndex * idx, FILE * fp1)
+{
+    IndexEntry * all  = NULL;
+    
+    int nall  = 0;
+    int ncap  = 0;
+    
+    IndexEntry e;
+    
+    memset(&e, 0, sizeof(e));
+    
+    while(!feof(fp1))
+    {
+        if(fgets(e.key, 21, fp1) == NULL)
+        {
+            break;
+        }
+
+        if(fscanf(fp1, "%d %d %ld %ld\n", &e.tot_rec, &e.tot_freq, &e.head_address, &e.tail_address) != 4)
+        {
+            break;
+        }
+
+        trim(e.key);
+        
+        if(nall == ncap)
+        {
+            ncap = ncap == 0 ? 1024 : ncap * 2;
+            
+            if((all = (IndexEntry *)realloc(all, ncap * sizeof(IndexEntry))) == NULL)
+            {
+                fprintf(stderr, "eatshow: out of memory building the index\n");
+                
+                exit(1);
+            }
+        }
+        
+        all[nall++] = e;
+    }
+    
+    hashIndex(idx, all, nall);
+    
+    return;
+}
+
+
+
+// Builds a minimal perfect hash of the keys of 'all' - every headword, in order - which the
+// index keeps (as its entries) from then on.  Where a key is duplicated the first one wins.
+//
+static void hashIndex(HeadwordIndex * idx, IndexEntry * all, int nall)
+{
+    IndexEntry * uniq   = NULL;
+    int        * bucket = NULL;
+    int        * start  = NULL;
+    int        * order  = NULL;
+    int        * slots  = NULL;
+    char       * taken  = NULL;
+    
+    int nkeys = 0;
+    int nb    = 0;
+    int i     = 0;
+    int j     = 0;
+    
+    if((uniq = (IndexEntry *)malloc((nall + 1) * sizeof(IndexEntry))) == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory building the index\n");
+        
+        exit(1);
+    }
+    
+    // Drop duplicated keys, keeping the first of each.  This is a one-off, so a simple
+    // open addressed set of entry numbers will do.
+    //
+    {
+        int   setSize = 1;
+        int * set;
+        
+        while(setSize < nall * 2)
+        {
+            setSize <<= 1;
+        }
+        
+        set = (int *)malloc(setSize * sizeof(int));
+        
+        for(i = 0; i < setSize; i++)
+        {
+            set[i] = -1;
+        }
+        
+        for(i = 0; i < nall; i++)
+        {
+            unsigned long long h = hashKey(all[i].key, 0) & (setSize - 1);
+            
+            while(set[h] != -1 && strcmp(uniq[set[h]].key, all[i].key) != WORD_FOUND)
+            {
+                h = (h + 1) & (setSize - 1);
+            }
+            
+            if(set[h] == -1)
+            {
+                set[h] = nkeys;
+                
+                uniq[nkeys++] = all[i];
+            }
+        }
+        
+        free(set);
+    }
+    
+    idx->nkeys    = nkeys;
+    idx->nbuckets = nb = nkeys / 4 + 1;
+    idx->disp     = (int *)calloc(nb, sizeof(int));
+    idx->raw      = malloc((nkeys + 1) * sizeof(IndexEntry));
+    idx->table    = (IndexEntry *)(((size_t)idx->raw + 63) & ~(size_t)63);
+    
+    bucket = (int *)malloc((nkeys + 1) * sizeof(int));
+    start  = (int *)calloc(nb + 1, sizeof(int));
+    order  = (int *)malloc(nb * sizeof(int));
+    slots  = (int *)malloc((nkeys + 1) * sizeof(int));
+    taken  = (char *)calloc(nkeys + 1, 1);
+    
+    if(idx->disp == NULL || idx->raw == NULL || bucket == NULL || start == NULL || order == NULL || slots == NULL || taken == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory building the index\n");
+        
+        exit(1);
+    }
+    
+    // Counting sort of the keys into buckets: bucket[start[b] .. start[b + 1]) are bucket b's keys.
+    //
+    for(i = 0; i < nkeys; i++)
+    {
+        start[hashKey(uniq[i].key, 0) % nb + 1]++;
+    }
+    
+    for(i = 0; i < nb; i++)
+    {
+        start[i + 1] += start[i];
+    }
+    
+    {
+        int * fill = (int *)malloc(nb * sizeof(int));
+        
+        memcpy(fill, start, nb * sizeof(int));
+        
+        for(i = 0; i < nkeys; i++)
+        {
+            bucket[fill[hashKey(uniq[i].key, 0) % nb]++] = i;
+        }
+        
+        free(fill);
+    }
+    
+    // Place the biggest buckets first, while the table is emptiest.  There are a lot of
+    // buckets but only a few sizes, so it's a (stable) counting sort on size.
+    //
+    {
+        int   maxSize = 0;
+        int * bySize;
+        
+        for(i = 0; i < nb; i++)
+        {
+            if(start[i + 1] - start[i] > maxSize)
+            {
+                maxSize = start[i + 1] - start[i];
+            }
+        }
+        
+        bySize = (int *)calloc(maxSize + 2, sizeof(int));
+        
+        for(i = 0; i < nb; i++)
+        {
+            bySize[maxSize - (start[i + 1] - start[i]) + 1]++;
+        }
+        
+        for(i = 0; i < maxSize + 1; i++)
+        {
+            bySize[i + 1] += bySize[i];
+        }
+        
+        for(i = 0; i < nb; i++)
+        {
+            order[bySize[maxSize - (start[i + 1] - start[i])]++] = i;
+        }
+        
+        free(bySize);
+    }
+    
+    for(i = 0; i < nb; i++)
+    {
+        int b    = order[i];
+        int size = start[b + 1] - start[b];
+        
+        unsigned int seed;
+        
+        if(size <= 1)
+        {
+            break;
+        }
+        
+        // Try seeds until every key in the bucket lands in a distinct free slot.
+        //
+        for(seed = 1; ; seed++)
+        {
+            int k;
+            
+            for(k = 0; k < size; k++)
+            {
+                int s = (int)(hashKey(uniq[bucket[start[b] + k]].key, seed) % nkeys);
+                int m;
+                
+                if(taken[s])
+                {
+                    break;
+                }
+                
+                for(m = 0; m < k && slots[m] != s; m++)
+                    ;
+                
+                if(m < k)
+                {
+                    break;
+                }
+                
+                slots[k] = s;
+            }
+            
+            if(k == size)
+            {
+                for(k = 0; k < size; k++)
+                {
+                    taken[slots[k]] = 1;
+                    
+                    idx->table[slots[k]] = uniq[bucket[start[b] + k]];
+                }
+                
+                idx->disp[b] = (int)seed;
+                
+                break;
+            }
+        }
+    }
+    
+    // Buckets with a single key just take the next free slot directly.
+    //
+    for(j = 0; i < nb; i++)
+    {
+        int b = order[i];
+        
+        if(start[b + 1] == start[b])
+        {
+            break;
+        }
+        
+        while(taken[j])
+        {
+            j++;
+        }
+        
+        taken[j] = 1;
+        
+        idx->table[j] = uniq[bucket[start[b]]];
+        idx->disp[b]  = -j - 1;
+    }
+    
+    idx->entries  = all;
+    idx->nentries = nall;
+    
+    free(taken);
+    free(slots);
+    free(order);
+    free(start);
+    free(bucket);
+    free(uniq);
+    
+    return;
+}
+
+
+
+// Finds 'cue' in a headword index.
+//
+// Returns: the index entry for cue, or NULL if it isn't a headword.
+//
+static const IndexEntry * lookupIndex(const HeadwordIndex * idx, const char * cue)
+{
+    const IndexEntry * entry;
+    
+    int d;
+    
+    if(idx->nkeys == 0)
+    {
+        return NULL;
+    }
+    
+    d = idx->disp[hashKey(cue, 0) % idx->nbuckets];
+    
+    entry = &idx->table[d < 0 ? -d - 1 : (int)(hashKey(cue, (unsigned int)d) % idx->nkeys)];
+    
+    tally.indexLines++;
+    
+    return strcmp(entry->key, cue) == WORD_FOUND ? entry : NULL;
+}
+
+
+
+// A checksum for compiled snapshots - quick enough to run over the whole file (8 bytes at a
+// time), which is all it's for.
+//
+static unsigned long long checksum(const void * data, size_t len)
+{
+    const unsigned char * p = (const unsigned char *)data;
+    
+    return checksumEnd(checksumWords(0x9E3779B97F4A7C15ULL ^ len, p, len / 8), p + (len & ~(size_t)7), len & 7);
+}
+
+
+
+// Mixes n 8 byte words into a checksum.
+//
+static unsigned long long checksumWords(unsigned long long h, const unsigned char * p, size_t n)
+{
+    unsigned long long w;
+    
+    for(; n > 0; n--, p += 8)
+    {
+        memcpy(&w, p, 8);
+        
+        h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 29;
+    }
+    
+    return h;
+}
+
+
+
+// Mixes the last (fewer than 8) bytes into a checksum, and finishes it.
+//
+static unsigned long long checksumEnd(unsigned long long h, const unsigned char * p, size_t len)
+{
+    for(; len > 0; len--)
+    {
+        h = (h ^ *p++) * 1099511628211ULL;
+    }
+    
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    
+    return h;
+}
+
+
+
+// Appends len bytes to a Buffer, growing it as needed.
+//
+static void bufAppend(Buffer * buf, const void * data, size_t len)
+{
+    bufReserve(buf, len);
+    
+    memcpy(buf->data + buf->len, data, len);
+    
+    buf->len += len;
+    
+    return;
+}
+
+
+
+// Makes room in a Buffer for another len bytes.
+//
+static void bufReserve(Buffer * buf, size_t len)
+{
+    if(buf->len + len > buf->cap)
+    {
+        size_t cap = buf->cap == 0 ? 4096 : buf->cap;
+        
+        while(cap < buf->len + len)
+        {
+            cap *= 2;
+        }
+        
+        if((buf->data = (char *)realloc(buf->data, cap)) == NULL)
+        {
+            fprintf(stderr, "eatshow: out of memory\n");
+            
+            exit(1);
+        }
+        
+        buf->cap = cap;
+    }
+    
+    return;
+}
+
+
+
+// Allocates 'len' bytes from this thread's arena - they last until the arena is released back
+// to a mark taken before.  A new block is only malloc'ed if none of the arena's blocks past
+// the current one has room, so once the arena has grown to what a query needs, queries cost
+// no mallocs at all.
+//
+static void * arenaAlloc(size_t len)
+{
+    ArenaBlock * b = arena.cur;
+    
+    len = (len + 15) & ~(size_t)15;
+    
+    if(b == NULL || arena.used + len > b->size)
+    {
+        // The blocks after cur are all free - take the first that's big enough.
+        //
+        ArenaBlock ** link = b != NULL ? &b->next : &arena.first;
+        
+        while(*link != NULL && (*link)->size < len)
+        {
+            link = &(*link)->next;
+        }
+        
+        if(*link == NULL)
+        {
+            size_t size = len > ARENABLOCK ? len : ARENABLOCK;
+            
+            if((*link = (ArenaBlock *)malloc(sizeof(ArenaBlock) + size)) == NULL)
+            {
+                fprintf(stderr, "eatshow: out of memory\n");
+                
+                exit(1);
+            }
+            
+            (*link)->next = NULL;
+            (*link)->size = size;
+            
+            tally.mallocs++;
+        }
+        
+        arena.cur  = b = *link;
+        arena.used = 0;
+    }
+    
+    arena.used += len;
+    
+    tally.arenaAllocs++;
+    tally.arenaBytes += len;
+    
+    return (char *)(b + 1) + arena.used - len;
+}
+
+
+
+// Makes the block at p - the arena's last allocation, of 'oldLen' bytes - 'len' bytes long, in
+// place if it can be or else by moving it.
+//
+// Returns: where the block now is.
+//
+static void * arenaGrow(void * p, size_t oldLen, size_t len)
+{
+    size_t  had  = (oldLen + 15) & ~(size_t)15;
+    size_t  want = (len + 15) & ~(size_t)15;
+    void  * q;
+    
+    if(p != NULL && arena.cur != NULL && (char *)p + had == (char *)(arena.cur + 1) + arena.used && arena.used - had + want <= arena.cur->size)
+    {
+        tally.arenaBytes += want - had;
+        
+        arena.used += want - had;
+        
+        return p;
+    }
+    
+    q = arenaAlloc(len);
+    
+    if(p != NULL)
+    {
+        memcpy(q, p, oldLen);
+    }
+    
+    return q;
+}
+
+
+
+// Where the arena is up to, for arenaRelease.
+//
+static ArenaMark arenaMark(void)
+{
+    ArenaMark mark;
+    
+    mark.block = arena.cur;
+    mark.used  = arena.used;
+    
+    return mark;
+}
+
+
+
+// Frees everything allocated from the arena since 'mark' was taken.  The blocks are kept.
+//
+static void arenaRelease(ArenaMark mark)
+{
+    arena.cur  = mark.block;
+    arena.used = mark.used;
+}
+
+
+
+// Frees the arena's blocks - for a thread that's about to exit.
+//
+static void arenaFree(void)
+{
+    while(arena.first != NULL)
+    {
+        ArenaBlock * next = arena.first->next;
+        
+        free(arena.first);
+        
+        arena.first = next;
+    }
+    
+    arena.cur  = NULL;
+    arena.used = 0;
+}
+
+
+
+// Reads a line, of any length, into the arena.
+//
+// Returns: the line, newline and all (as fgets), or NULL at the end of the file.
+//
+static char * readLine(FILE * fp)
+{
+    size_t cap = 256;
+    size_t len = 0;
+    char * line = (char *)arenaAlloc(cap);
+    
+    while(fgets(line + len, (int)(cap - len), fp) != NULL)
+    {
+        len += strlen(line + len);
+        
+        if(len > 0 && line[len - 1] == '\n')
         {
-            fail = 1;
-            
-            break;
+            return line;
         }
+        
+        if(len + 1 == cap)
+        {
+            line = (char *)arenaGrow(line, cap, cap * 2);
+            cap *= 2;
+        }
+    }
+    
+    return len > 0 ? line : NULL;
+}
+
+
+
+// Gets the size and modification time of one of the text files a snapshot is compiled from.
+//
+// Returns: false if the file isn't there.
+//
+static bool sourceStamp(const char * name, unsigned long long stamp[2])
+{
+    struct stat st;
+    
+    if(stat(name, &st) != 0)
+    {
+        return false;
+    }
+    
+    stamp[0] = (unsigned long long)st.st_size;
+    stamp[1] = (unsigned long long)st.st_mtime;
+    
+    return true;
+}
+
+
+
+// Checks that an array of 'len' bytes at 'off' in a snapshot of 'size' bytes is all inside it,
+// after the header and 64 byte aligned, as compileSnapshot writes them.
+//
+static bool snapFits(unsigned long long off, unsigned long long len, size_t size)
+{
+    return off >= sizeof(SnapHeader) && (off & 63) == 0 && off <= size && len <= size - off;
+}
+
+
+
+// Sums a snapshot's body on as far as 'to', in whole words - the rest is left for later.
+//
+static void snapSumTo(SnapSum * sum, const void * to)
+{
+    const unsigned char * end = (const unsigned char *)to;
+    
+    if(end > sum->at)
+    {
+        size_t n = (size_t)(end - sum->at) / 8;
+        
+        sum->h   = checksumWords(sum->h, sum->at, n);
+        sum->at += n * 8;
+    }
+}
+
 
-        if(fscanf(fp1, "%d %d %ld %ld\n", &tot_rec, &tot_freq, &head_address, &tail_address) != 4)
+
+// Checks that each of n snapshot index entries has a terminated key and, unless it has no list,
+// a list inside the nassoc associations - summing them a block at a time just before.
+//
+static bool snapEntriesSound(const IndexEntry * e, int n, int nassoc, SnapSum * sum)
+{
+    int k;
+    
+    for(k = 0; k < n; k++)
+    {
+        if((k & (SNAPBLOCK - 1)) == 0)
         {
-            fail = 2;
-            
-            break;
+            snapSumTo(sum, e + (n - k > SNAPBLOCK ? k + SNAPBLOCK : n));
+        }
+        
+        if(memchr(e[k].key, '\0', sizeof(e[k].key)) == NULL || (e[k].first != -1 && (e[k].first < 0 || e[k].nassoc < 0 || e[k].first > nassoc - e[k].nassoc)))
+        {
+            return false;
         }
+    }
+    
+    return true;
+}
+
 
-        trim(index_word);
 
-        if(strcmp(index_word, cue) == WORD_FOUND)
+// Checks a snapshot whose header is sound before anything in it is used: that every array is
+// inside the file, that everything pointing into another array - a bucket's slot, an entry's
+// list, an association's word - stays inside it, and the body's checksum, for anything else.
+// So a damaged or truncated snapshot is never read out of bounds, or used at all.  The arrays
+// are checked as the checksum passes over them, so the file is only read through once.
+//
+// Returns: false if it fails any of them.
+//
+static bool snapSound(const SnapHeader * h, size_t size)
+{
+    const char * base = (const char *)h;
+    
+    SnapSum sum;
+    
+    long k;
+    int  d;
+    
+    sum.at = (const unsigned char *)base + sizeof(SnapHeader);
+    sum.h  = 0x9E3779B97F4A7C15ULL ^ (size - sizeof(SnapHeader));
+    
+    if(!snapFits(h->pool, h->poolSize, size) || h->poolSize == 0)
+    {
+        return false;
+    }
+    
+    for(d = 0; d < 2; d++)
+    {
+        const SnapSection * sec = &h->dir[d];
+        const int         * disp;
+        const SnapAssoc   * assoc;
+        
+        if(sec->nkeys < 0 || sec->nbuckets < 0 || sec->nentries < 0 || sec->nassoc < 0 || (sec->nkeys > 0 && sec->nbuckets == 0) ||
+           !snapFits(sec->table, (unsigned long long)sec->nkeys * sizeof(IndexEntry), size) ||
+           !snapFits(sec->disp, (unsigned long long)sec->nbuckets * sizeof(int), size) ||
+           !snapFits(sec->entries, (unsigned long long)sec->nentries * sizeof(IndexEntry), size) ||
+           !snapFits(sec->assoc, (unsigned long long)sec->nassoc * sizeof(SnapAssoc), size))
+        {
+            return false;
+        }
+        
+        disp  = (const int *)(base + sec->disp);
+        assoc = (const SnapAssoc *)(base + sec->assoc);
+        
+        // In the order compileSnapshot writes them, so the sum only ever moves on.
+        //
+        if(!snapEntriesSound((const IndexEntry *)(base + sec->table), sec->nkeys, sec->nassoc, &sum))
+        {
+            return false;
+        }
+        
+        for(k = 0; k < sec->nbuckets; k++)
+        {
+            if(disp[k] < 0 && -(long)disp[k] - 1 >= sec->nkeys)
+            {
+                return false;
+            }
+        }
+        
+        if(!snapEntriesSound((const IndexEntry *)(base + sec->entries), sec->nentries, sec->nassoc, &sum))
+        {
+            return false;
+        }
+        
+        // Each word is '\0' terminated in the pool, so that has to be inside it too.
+        //
+        for(k = 0; k < sec->nassoc; k++)
         {
-            fail = 0;
+            if((k & (SNAPBLOCK - 1)) == 0)
+            {
+                snapSumTo(&sum, assoc + (sec->nassoc - k > SNAPBLOCK ? k + SNAPBLOCK : sec->nassoc));
+            }
             
-            break;
+            if(assoc[k].word >= h->poolSize || assoc[k].len >= h->poolSize - assoc[k].word)
+            {
+                return false;
+            }
         }
     }
+    
+    snapSumTo(&sum, base + size);
+    
+    return h->bodySum == checksumEnd(sum.h, sum.at, (size_t)(base + size - (const char *)sum.at));
+}
 
-    if(fail != 0)
+
+
+// Maps a compiled snapshot and, if it's sound, points both Datasets into it.  A snapshot
+// compiled from text files that have since changed is not used, and nor is one that
+// snapSound finds damaged.
+//
+// Returns: false if there's no usable snapshot.
+//
+static bool loadSnapshot(const char * file)
+{
+    const char * sources[4] = { dataPath(SRFILE), dataPath(RSFILE), dataPath(SRINDEX), dataPath(RSINDEX) };
+    
+    Dataset          * dirs[2] = { &engine.sr, &engine.rs };
+    const SnapHeader * h;
+    
+    MappedFile mf;
+    
+    int d;
+    int k;
+    
+    if(!mapFile(file, &mf))
     {
-        printf("eatshow: %s: not found\n", cue);
+        return false;
     }
-    else // We found 'cue' - w00t!
+    
+    h = (const SnapHeader *)mf.base;
+    
+    if(mf.size < sizeof(SnapHeader) || memcmp(h->magic, "EATSNAP", 8) != 0 || h->version != SNAPVERSION ||
+       h->byteOrder != 0x01020304 || h->entrySize != sizeof(IndexEntry) || h->fileSize != mf.size ||
+       h->headSum != checksum(h, offsetof(SnapHeader, headSum)))
+    {
+        fprintf(stderr, "eatshow: %s is not a usable snapshot (run eatshow --compile) - using the text files\n", file);
+        
+        unmapFile(&mf);
+        
+        return false;
+    }
+    
+    for(k = 0; k < 4; k++)
+    {
+        unsigned long long stamp[2];
+        
+        if(sourceStamp(sources[k], stamp) && (stamp[0] != h->sources[k][0] || stamp[1] != h->sources[k][1]))
+        {
+            fprintf(stderr, "eatshow: %s has changed since %s was compiled - using the text files\n", sources[k], file);
+            
+            unmapFile(&mf);
+            
+            return false;
+        }
+    }
+    
+    if(!snapSound(h, mf.size))
+    {
+        fprintf(stderr, "eatshow: %s is damaged (run eatshow --compile) - using the text files\n", file);
+        
+        unmapFile(&mf);
+        
+        return false;
+    }
+    
+    for(d = 0; d < 2; d++)
+    {
+        const SnapSection * sec = &h->dir[d];
+        
+        Dataset * ds = dirs[d];
+        
+        ds->mode               = d == 0 ? 's' : 'r';
+        ds->length             = sec->nentries;
+        ds->data.base          = "";
+        ds->data.size          = 0;
+        ds->index.table        = (IndexEntry *)(mf.base + sec->table);
+        ds->index.disp         = (int *)(mf.base + sec->disp);
+        ds->index.entries      = (IndexEntry *)(mf.base + sec->entries);
+        ds->index.nkeys        = sec->nkeys;
+        ds->index.nbuckets     = sec->nbuckets;
+        ds->index.nentries     = sec->nentries;
+        ds->assoc              = (const SnapAssoc *)(mf.base + sec->assoc);
+        ds->pool               = mf.base + h->pool;
+    }
+    
+    engine.snap = mf;
+    
+    return true;
+}
+
+
+
+// Writes the text dbs out as a compiled snapshot: both indexes' hash tables exactly as they
+// sit in memory, every association list decoded into SnapAssocs, and one string pool holding
+// each distinct word once.
+//
+static void compileSnapshot(const char * file)
+{
+    const char * sources[4] = { dataPath(SRFILE), dataPath(RSFILE), dataPath(SRINDEX), dataPath(RSINDEX) };
+    
+    Dataset * dirs[2] = { &engine.sr, &engine.rs };
+    Buffer    assoc[2];
+    Buffer    pool;
+    
+    SnapHeader hdr;
+    
+    unsigned int * set     = NULL;
+    size_t         setSize = 1 << 16;
+    size_t         nwords  = 0;
+    size_t         off;
+    
+    char * image;
+    FILE * out;
+    
+    int d;
+    int i;
+    
+    bTextOnly  = true;
+    bTranspose = false;
+    nBudget    = 0;
+    
+    loadEngine();
+    
+    memset(&hdr, 0, sizeof(hdr));
+    memset(assoc, 0, sizeof(assoc));
+    memset(&pool, 0, sizeof(pool));
+    
+    // The pool's first byte is an empty string, so offset 0 is never a real word's.
+    //
+    bufAppend(&pool, "", 1);
+    
+    set = (unsigned int *)calloc(setSize, sizeof(unsigned int));
+    
+    for(d = 0; d < 2; d++)
     {
-        if(fseek(fp, tail_address, 0) != -1)
+        HeadwordIndex * idx = &dirs[d]->index;
+        
+        for(i = 0; i < idx->nentries; i++)
         {
-            if(fgets(response_word, MAXBUF, fp) == NULL)
+            IndexEntry * e = &idx->entries[i];
+            AssocCursor  cur;
+            
+            const char * word;
+            
+            int wordLen;
+            int count;
+            
+            e->first  = -1;
+            e->nassoc = 0;
+            
+            if(!openAssoc(dirs[d], e, &cur))
             {
-                printf("eatshow: %ld: bad address index file\n", tail_address);
+                continue;
             }
-            else
-            {         
-                int nCount = 0;
-                
-                out1 = NULL;
+            
+            e->first = (int)(assoc[d].len / sizeof(SnapAssoc));
+            
+            while(nextAssoc(&cur, &word, &wordLen, &count))
+            {
+                SnapAssoc          a;
+                unsigned long long h = 14695981039346656037ULL;
+                size_t             k;
                 
-                if(bDemark)
+                for(k = 0; k < (size_t)wordLen; k++)
                 {
-                    puts("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+                    h = (h ^ (unsigned char)word[k]) * 1099511628211ULL;
                 }
                 
-                while(out1 = strtok(out1 == NULL ? response_word :  (char *) 0  , "|"))
+                // Intern the word (open addressing on pool offsets, doubled when half full).
+                //
+                if(nwords * 2 >= setSize)
                 {
-                    out2 = strtok((char *) 0, "|");
+                    unsigned int * bigger = (unsigned int *)calloc(setSize * 2, sizeof(unsigned int));
+                    size_t         n;
                     
-                    count = atoi(out2);
-
-                    // Limit the output to nLimit entries?
-                    //
-                    if(bLimit)
+                    for(n = 0; n < setSize; n++)
                     {
-                        if(nCount >= nLimit)
+                        if(set[n] != 0)
                         {
-                            break;
+                            const char * w = pool.data + set[n];
+                            
+                            unsigned long long g = 14695981039346656037ULL;
+                            
+                            for(; *w; w++)
+                            {
+                                g = (g ^ (unsigned char)*w) * 1099511628211ULL;
+                            }
+                            
+                            for(g &= setSize * 2 - 1; bigger[g] != 0; g = (g + 1) & (setSize * 2 - 1))
+                                ;
+                            
+                            bigger[g] = set[n];
                         }
                     }
+                    
+                    free(set);
+                    
+                    set      = bigger;
+                    setSize *= 2;
+                }
                 
+                for(h &= setSize - 1; set[h] != 0; h = (h + 1) & (setSize - 1))
+                {
+                    const char * w = pool.data + set[h];
+                    
+                    if(strncmp(w, word, wordLen) == 0 && w[wordLen] == '\0')
                     {
-                        char buffer[100];
-
-                        // Number the outputs?
-                        //
-                        if(bNumber)
-                        {
-                            ++nCount;
-            
-                            sprintf(buffer, "%4d: %s", nCount, out1);
-                                            
-                            prop = ((float) count / (float) tot_freq);
-                                            
-                            out(buffer, count, prop);
-                        }
-                        else
-                        {
-                            sprintf(buffer, "      %s", out1);
-
-                            out(buffer, count, prop);
-                        }
+                        break;
                     }
                 }
                 
-                if(bDemark)
+                if(set[h] == 0)
                 {
-                    puts("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
-                }
-
-                printf("\n\t%s %s\n\n", cue, sourcef == 'r' ? "was [one of] the 'response(s)' to the stimulli above" : "was [one of] the 'stimuli' to the responses above");
+                    set[h] = (unsigned int)pool.len;
                     
-                printf("\tNumber of different answers: %d\n", tot_rec);
+                    bufAppend(&pool, word, wordLen);
+                    bufAppend(&pool, "", 1);
+                    
+                    nwords++;
+                }
                 
-                printf("\t Total count of all answers: %d\n\n", tot_freq);
+                a.word  = set[h];
+                a.len   = (unsigned int)wordLen;
+                a.count = count;
                 
+                bufAppend(&assoc[d], &a, sizeof(a));
+                
+                e->nassoc++;
             }
         }
-        else
+        
+        // The hash table holds copies of the first entry for each key - give them its list.
+        //
+        for(i = 0; i < idx->nentries; i++)
         {
-            printf("eatshow: %ld: bad address index file\n", tail_address);
-        }
+            IndexEntry * t = (IndexEntry *)lookupIndex(idx, idx->entries[i].key);
             
-        rewind(fp1);
+            if(t != NULL && t->tail_address == idx->entries[i].tail_address)
+            {
+                t->first  = idx->entries[i].first;
+                t->nassoc = idx->entries[i].nassoc;
+            }
+        }
+    }
+    
+    free(set);
+    
+    // Lay the file out - every array on a 64 byte boundary.
+    //
+    #define SNAP_ALIGN(n) (((n) + 63) & ~(unsigned long long)63)
+    
+    off = SNAP_ALIGN(sizeof(SnapHeader));
+    
+    for(d = 0; d < 2; d++)
+    {
+        HeadwordIndex * idx = &dirs[d]->index;
+        SnapSection   * sec = &hdr.dir[d];
+        
+        sec->nkeys    = idx->nkeys;
+        sec->nbuckets = idx->nbuckets;
+        sec->nentries = idx->nentries;
+        sec->nassoc   = (int)(assoc[d].len / sizeof(SnapAssoc));
+        
+        sec->table    = off;  off = SNAP_ALIGN(off + (size_t)idx->nkeys    * sizeof(IndexEntry));
+        sec->disp     = off;  off = SNAP_ALIGN(off + (size_t)idx->nbuckets * sizeof(int));
+        sec->entries  = off;  off = SNAP_ALIGN(off + (size_t)idx->nentries * sizeof(IndexEntry));
+        sec->assoc    = off;  off = SNAP_ALIGN(off + assoc[d].len);
+    }
+    
+    hdr.pool     = off;
+    hdr.poolSize = pool.len;
+    hdr.fileSize = off = SNAP_ALIGN(off + pool.len);
+    
+    #undef SNAP_ALIGN
+    
+    if((image = (char *)calloc(off, 1)) == NULL)
+    {
+        fprintf(stderr, "eatshow: out of memory\n");
+        
+        exit(1);
+    }
+    
+    for(d = 0; d < 2; d++)
+    {
+        HeadwordIndex * idx = &dirs[d]->index;
+        SnapSection   * sec = &hdr.dir[d];
+        
+        memcpy(image + sec->table,   idx->table,   (size_t)idx->nkeys    * sizeof(IndexEntry));
+        memcpy(image + sec->disp,    idx->disp,    (size_t)idx->nbuckets * sizeof(int));
+        memcpy(image + sec->entries, idx->entries, (size_t)idx->nentries * sizeof(IndexEntry));
+        memcpy(image + sec->assoc,   assoc[d].data, assoc[d].len);
+        
+        free(assoc[d].data);
+    }
+    
+    memcpy(image + hdr.pool, pool.data, pool.len);
+    
+    free(pool.data);
+    
+    memcpy(hdr.magic, "EATSNAP", 8);
+    
+    hdr.version   = SNAPVERSION;
+    hdr.byteOrder = 0x01020304;
+    hdr.entrySize = sizeof(IndexEntry);
+    
+    for(i = 0; i < 4; i++)
+    {
+        sourceStamp(sources[i], hdr.sources[i]);
+    }
+    
+    hdr.bodySum = checksum(image + sizeof(SnapHeader), off - sizeof(SnapHeader));
+    hdr.headSum = checksum(&hdr, offsetof(SnapHeader, headSum));
+    
+    memcpy(image, &hdr, sizeof(hdr));
+    
+    if((out = fopen(file, "wb")) == NULL || fwrite(image, 1, off, out) != off || fclose(out) != 0)
+    {
+        fprintf(stderr, "eatshow: cannot write the file: %s\n", file);
+        
+        exit(1);
     }
     
+    free(image);
+    
+    printf("eatshow: compiled %d + %d headwords, %d + %d associations and %lu distinct words into %s (%lu bytes)\n",
+           hdr.dir[0].nkeys, hdr.dir[1].nkeys, hdr.dir[0].nassoc, hdr.dir[1].nassoc, (unsigned long)nwords, file, (unsigned long)off);
+    
     return;
 }
 
 
 
+// Checks a compiled snapshot's contents against the checksum it was written with.
+//
+// Returns: true if it matches.
+//
+static bool verifySnapshot(const char * file)
+{
+    const SnapHeader * h;
+    
+    MappedFile mf;
+    
+    bool ok;
+    
+    if(!mapFile(file, &mf))
+    {
+        fprintf(stderr, "cannot access the file: %s\n", file);
+        
+        return false;
+    }
+    
+    h = (const SnapHeader *)mf.base;
+    
+    ok = mf.size >= sizeof(SnapHeader) && memcmp(h->magic, "EATSNAP", 8) == 0 && h->fileSize == mf.size &&
+         h->headSum == checksum(h, offsetof(SnapHeader, headSum)) && snapSound(h, mf.size);
+    
+    printf("eatshow: %s: %s\n", file, ok ? "sound" : "damaged - recompile it");
+    
+    unmapFile(&mf);
+    
+    return ok;
+}
+
+
+
 // Toggles the database being used (Response/Stimulus) if passed '-sw'.
 //
 // Returns: true if the database was toggled, else false.
@@ -412,19 +10594,25 @@ static bool toggleDataBaseCheck(char * cue)
 {
     if(!strcmp(cue, "-sw"))
     {
+        FILE * fp = outFormat == FORMAT_TEXT ? stdout : stderr;
+        
         if(sourcef == 's')
         {
-            puts("\t>>Mode switched from Stimulus to Response");
+            fputs("\t>>Mode switched from Stimulus to Response\n", fp);
             
             sourcef = 'r';
         }
         else
         {
-            puts("\t>>Mode switched from Response to Stimulus");
+            fputs("\t>>Mode switched from Response to Stimulus\n", fp);
                         
             sourcef = 's';
         }
         
+        // Both dbs are resident, so switching is just a matter of pointing at the other one.
+        //
+        engine.cur = sourcef == 'r' ? &engine.rs : &engine.sr;
+        
         return true;
     }    
     else
@@ -497,41 +10685,47 @@ static void checkInitRun(void)
 
 
 
-// Produces a raw dump of the words in the current db's index file - numbers the output.
+// Produces a raw dump of the words in the current db's index file - numbers the output.  It goes
+// to stderr with --format, as it isn't a record.
 //
 static bool dumpWords(char * cue)
 {
     if(!strcmp(cue, "-x"))
     {
-        char index_word[MAXBUF];    
+        const HeadwordIndex * idx = &engine.cur->index;
         
-        int  ndummy  = 0;
-        long lcount  = 0;
+        FILE * fp = outFormat == FORMAT_TEXT ? stdout : stderr;
         
-        doFileCloseOpen(sourcef, &fp, &fp1, &index_length);
+        long lcount = 0;
         
-        while(!feof(fp1))
+        if(engine.cur->paged)
         {
-            if(fgets(index_word, 21, fp1) == NULL)
-            {
-                break;
-            }
-    
-            if(fscanf(fp1, "%d %d %d %d\n", &ndummy, &ndummy, &ndummy, &ndummy) != 4)
+            PagedIndex * pi = &engine.cur->pindex;
+            
+            long pos = 0;
+            
+            while(pos < pi->end)
             {
-                break;
+                char       window[512];
+                long       n = pagedRead(&pi->file, pos, window, sizeof(window));
+                IndexEntry e;
+                
+                pos += parseIndexLine(window, window + n, &e);
+                
+                fprintf(fp, "%5ld: %s\n", ++lcount, e.key);
             }
-    
-            trim(index_word);
+        }
+        
+        while(lcount < idx->nentries)
+        {
+            fprintf(fp, "%5ld: %s\n", lcount + 1, idx->entries[lcount].key);
             
-            printf("%5ld: %s\n", ++lcount, index_word);
+            lcount++;
         }
 
-        printf("\nAlthough %ld entries were listed, as this is a raw dump of the index,\n", lcount);
-        puts("the output will contain a number of duplicates.");
+        fprintf(fp, "\nAlthough %ld entries were listed, as this is a raw dump of the index,\n", lcount);
+        fputs("the output will contain a number of duplicates.\n", fp);
     
-        rewind(fp1);     
-        
         return true;
     }
     
@@ -591,7 +10785,7 @@ static void about(void)
 //
 static void usage(void)
 {                               
-    puts("Usage: eatshow [-a -d -f -i -n -r -s -sw -t -x -?] [word_list]");
+    puts("Usage: eatshow [-a -b -c -d -f -i -j -m -n -p -r -s -sw -t -x -?] [word_list]");
     puts("Find associates to words in the Edinburgh Associative Thesaurus");
     puts("");    
     puts("Outputs:");
@@ -604,19 +10798,70 @@ static void usage(void)
     puts("");    
     puts("Switches:");
     puts("\t-a \t further info about this application");
+    puts("\t-b<file> looks up every word (one per line) in a file as a single batch");
+    puts("\t-c<kb>\t cache up to <kb> KB of rendered results (default 8192, or");
+    puts("\t\t none with -m; -c0 turns the cache off)");
     puts("\t-d \t turn off results demarcation");    
     puts("\t-f<file> echo screen output to a file");
     puts("\t-i<file> reads/processes input from a file a line at a time");
+    puts("\t-j<n>\t renders a -b batch on <n> threads (or runs <n> --serve workers)");
     puts("\t-l<n>\t limits the number of outputs to <n>");
+    puts("\t-m<kb>\t page the files through a buffer pool of about <kb> KB");
+    puts("\t\t instead of keeping them in memory (reports its use at exit)");
     puts("\t-n \t number outputs");
+    puts("\t-p \t prefault the data files into memory at startup");
     puts("\t-r \t use cue as response");
     puts("\t-s \t use cue as stimulus(default)");
     puts("\t-sw\t toggles the -r/-s mode [without restart] (runtime switch)");
     puts("\t-t \t tab-delimit output [default is to use spaces]");
     puts("\t-x \t dumps the index wordlist for the current mode (runtime switch)");
     puts("\t-? \t display these options");
+    puts("");
+    puts("\t--compile [file] compile the data and index files into a snapshot");
+    puts("\t\t (default ./eatshow.snap, which is then used automatically)");
+    puts("\t--verify [file]  check a snapshot's checksums");
+    puts("\t--text\t ignore any snapshot and read the text files");
+    puts("\t--pipe [bin] co-process mode: answer requests on stdin as they come");
+    puts("\t\t (tab-separated lines, or binary frames with 'bin' - see README)");
+    puts("\t--serve <socket> run as a daemon answering requests on a Unix socket");
+    puts("\t--stats [json]\t report each cue's timings and counters, and totals,");
+    puts("\t\t on stderr at exit (as JSON with 'json')");
+    puts("\t--trace <file>\t record every query (cue, options, time, latency) to a file");
+    puts("\t--replay <file> [max] re-issue a trace's queries, as recorded or flat out,");
+    puts("\t\t and compare the latencies");
+    puts("\t--bench-split [n] time decoding every association list <n> times (default");
+    puts("\t\t 20), with strtok and atoi and then with the splitter");
+    puts("\t--data <dir>\t read the data and index files (and snapshot) from <dir>");
+    puts("\t--generate <scale> <dir> write a synthetic thesaurus <scale> times the");
+    puts("\t\t size of this one to <dir> (for --data)");
+    puts("\t--build-index [check] rebuild the index files from the data files (in");
+    puts("\t\t parallel, on -j<n> threads), or with 'check' just report any drift");
+    puts("\t--transpose\t derive the r-s lists from the s-r ones, rather than");
+    puts("\t\t reading their own files (on -j<n> threads)");
+    puts("\t--expand <n>\t answer each cue with the words it leads to in up to <n>");
+    puts("\t\t associations, best chain first (-l<n> of them, default 20)");
+    puts("\t--path\t\t answer each pair of words (FROM TO - on a line, tab or space");
+    puts("\t\t separated) with the strongest chain of associations between them");
+    puts("\t--activate\t answer each cue (a word, or several split by commas) with the");
+    puts("\t\t words activation spreads to from it - personalized PageRank");
+    puts("\t--restart <a>\t --activate's share back to the seeds each step (default 0.15)");
+    puts("\t--tolerance <e> --activate's convergence (default 0.000001)");
+    puts("\t--push\t\t --activate from one word by pushing, not power iteration");
+    puts("\t--power\t\t --activate by power iteration (the default)");
+    puts("\t--similar\t answer each cue with the headwords whose lists are most like");
+    puts("\t\t its own, as distributions (-l<n> of them, default 20)");
+    puts("\t--metric <m>\t how --similar compares lists - cosine (default), jaccard or js");
+    puts("\t--beam <n>\t --expand goes on from the <n> best words at each hop");
+    puts("\t\t (default 256, 0 for all)");
+    puts("\t--threshold <p> --expand drops chains scoring under <p> (default 0.00001)");
+    puts("\t--graph [word]\t build the association graph (every word numbered, both");
+    puts("\t\t directions as arrays) and report its size, or <word>'s node");
+    puts("\t--format=<f>\t output each cue as one record - jsonl, csv or bin");
+    puts("\t\t (columnar binary) - rather than as text (see README)");
+    puts("\t--bench [file]\t time lookups of every headword, cold and warm, on one");
+    puts("\t\t and -j<n> threads (results also to file, default ./eatshow.bench)");
     puts("");    
-    puts("NOTE: If -i or a word_list is used, eatshow does not enter interactive mode");
+    puts("NOTE: If -b, -i or a word_list is used, eatshow does not enter interactive mode");
     puts("");
     puts("In interactive mode, to return to the command prompt, simply hit return");
     puts("(do not enter a word). Alternately, enter Ctrl + Z");
@@ -626,6 +10871,47 @@ static void usage(void)
 
 
 
+// Where one of the four files (or the snapshot) is - in the --data directory, if there's one.
+//
+static const char * dataPath(const char * file)
+{
+    static const char * const files[5] = { SRFILE, RSFILE, SRINDEX, RSINDEX, SNAPFILE };
+    static char             * paths[5];
+    
+    int i;
+    
+    if(dataDir == NULL)
+    {
+        return file;
+    }
+    
+    for(i = 0; i < 5 && files[i] != file; i++)
+        ;
+    
+    if(i == 5)
+    {
+        return file;
+    }
+    
+    // Built the first time each is asked for - every one is "./name".
+    //
+    if(paths[i] == NULL)
+    {
+        if((paths[i] = (char *)malloc(strlen(dataDir) + strlen(file))) == NULL)
+        {
+            fprintf(stderr, "eatshow: out of memory\n");
+            
+            exit(1);
+        }
+        
+        sprintf(paths[i], "%s/%s", dataDir, file + 2);
+    }
+    
+    return paths[i];
+}
+
+
+
 // Trims a LF off a string by inserting a '\0' in the location
 // of the first LF found.
 //
@@ -691,6 +10977,13 @@ static void actOnFlag(char * f)
             about();
             break;
             
+        case 'b':                   // batch of words from a file.
+            if(*f != '\0')
+            {
+                batchFile = f;
+            }
+            break;
+            
         case 'd':                   // add demarcation lines.
             bDemark = false;
             break;
@@ -699,6 +10992,31 @@ static void actOnFlag(char * f)
             bNumber = true;
             break;
             
+        case 'm':                   // bounded memory - page files through a buffer pool.
+            if(*f != '\0')
+            {
+                nBudget = atol(f);
+            }
+            break;
+            
+        case 'j':                   // threads for a batch.
+            if(*f != '\0' && atoi(f) > 0)
+            {
+                nThreads = atoi(f);
+            }
+            break;
+            
+        case 'c':                   // result cache size.
+            if(*f != '\0')
+            {
+                nCache = atol(f);
+            }
+            break;
+            
+        case 'p':                   // prefault the data files.
+            bPrefault = true;
+            break;
+            
         case 'l':                   // limit the number of outputs.
             if(*f != '\0')
             {
@@ -737,6 +11055,267 @@ static void actOnFlag(char * f)
 
 
 
+// Parses a --long option (argv[i]).  Some are complete commands in themselves and exit.
+//
+// Returns: the index of the last arg used (options with arguments use the ones after them).
+//
+static int actOnLongFlag(int argc, char * argv[], int i)
+{
+    const char * f = argv[i] + 2;
+    
+    // An optional argument is the next arg, if there is one that isn't itself a switch.
+    //
+    const char * arg = i + 1 < argc && *argv[i + 1] != '-' ? argv[i + 1] : NULL;
+    
+    if(!strcmp(f, "compile"))               // compile the text files to a snapshot.
+    {
+        compileSnapshot(arg != NULL ? arg : dataPath(SNAPFILE));
+        exit(0);
+    }
+    else if(!strcmp(f, "verify"))           // check a snapshot's checksums.
+    {
+        exit(verifySnapshot(arg != NULL ? arg : dataPath(SNAPFILE)) ? 0 : 1);
+    }
+    else if(!strcmp(f, "text"))             // don't use a snapshot.
+    {
+        bTextOnly = true;
+    }
+    else if(!strcmp(f, "pipe"))             // co-process mode - 'bin' for binary frames.
+    {
+        if(arg != NULL && strcmp(arg, "bin") && strcmp(arg, "tsv"))
+        {
+            usage();
+        }
+        
+        pipeMode = arg != NULL && !strcmp(arg, "bin") ? 2 : 1;
+        
+        i += arg != NULL;
+    }
+    else if(!strcmp(f, "serve"))            // run as a daemon on a socket.
+    {
+        if(arg == NULL)
+        {
+            usage();
+        }
+        
+        serveSocket = argv[++i];
+    }
+    else if(!strcmp(f, "stats"))            // report timings and counters at exit.
+    {
+        // Only 'json' is taken as its argument - anything else is a word.
+        //
+        bool json = arg != NULL && !strcmp(arg, "json");
+        
+        if(statsMode == 0)
+        {
+            atexit(reportStats);
+        }
+        
+        statsMode = json ? 2 : 1;
+        
+        i += json;
+    }
+    else if(!strcmp(f, "trace"))            // record every query to a file.
+    {
+        if(arg == NULL)
+        {
+            usage();
+        }
+        
+        if(traceFile == NULL)
+        {
+            startTrace(arg);
+        }
+        
+        i++;
+    }
+    else if(!strcmp(f, "replay"))           // re-issue a --trace file's queries.
+    {
+        if(arg == NULL)
+        {
+            usage();
+        }
+        
+        replayFile = argv[++i];
+        
+        if(i + 1 < argc && !strcmp(argv[i + 1], "max"))
+        {
+            bReplayMax = true;
+            
+            i++;
+        }
+    }
+    else if(!strcmp(f, "bench-split"))      // time the association list splitter.
+    {
+        runSplitBench(arg != NULL && atoi(arg) > 0 ? atoi(arg) : 20);
+        exit(0);
+    }
+    else if(!strcmp(f, "data"))             // read the four files from another directory.
+    {
+        if(arg == NULL)
+        {
+            usage();
+        }
+        
+        dataDir = argv[++i];
+    }
+    else if(!strcmp(f, "generate"))         // write a synthetic thesaurus, 'scale' times the size.
+    {
+        if(arg == NULL || i + 2 >= argc)
+        {
+            usage();
+        }
+        
+        generateData(arg, argv[i + 2]);
+        exit(0);
+    }
+    else if(!strncmp(f, "format", 6) && (f[6] == '=' || f[6] == '\0'))   // jsonl, csv or bin records.
+    {
+        const char * name = f[6] == '=' ? f + 7 : arg;
+        
+        if(name == NULL)
+        {
+            usage();
+        }
+        
+        if(!strcmp(name, "text"))
+        {
+            outFormat = FORMAT_TEXT;
+        }
+        else if(!strcmp(name, "jsonl"))
+        {
+            outFormat = FORMAT_JSONL;
+        }
+        else if(!strcmp(name, "csv"))
+        {
+            outFormat = FORMAT_CSV;
+        }
+        else if(!strcmp(name, "bin"))
+        {
+            outFormat = FORMAT_BIN;
+        }
+        else
+        {
+            usage();
+        }
+        
+        i += f[6] == '\0';
+    }
+    else if(!strcmp(f, "transpose"))        // derive the r-s lists from the s-r ones.
+    {
+        bTranspose = true;
+    }
+    else if(!strcmp(f, "expand"))           // answer cues with the words they lead to, in up to n hops.
+    {
+        if(arg == NULL || atoi(arg) < 1 || atoi(arg) > 8)
+        {
+            usage();
+        }
+        
+        graphQuery = GRAPH_EXPAND;
+        expandHops = atoi(argv[++i]);
+    }
+    else if(!strcmp(f, "path"))             // answer pairs of words with the strongest chain between them.
+    {
+        graphQuery = GRAPH_PATH;
+    }
+    else if(!strcmp(f, "activate"))         // answer cues with the words activation spreads to from them.
+    {
+        graphQuery = GRAPH_ACTIVATE;
+    }
+    else if(!strcmp(f, "restart"))          // the share of --activate's activation that goes back to the seeds.
+    {
+        if(arg == NULL || atof(arg) <= 0 || atof(arg) >= 1)
+        {
+            usage();
+        }
+        
+        restartProb = atof(argv[++i]);
+    }
+    else if(!strcmp(f, "tolerance"))        // how closely --activate converges.
+    {
+        if(arg == NULL || atof(arg) <= 0)
+        {
+            usage();
+        }
+        
+        tolerance = atof(argv[++i]);
+    }
+    else if(!strcmp(f, "power"))            // --activate by power iteration - the default.
+    {
+        bPush = false;
+    }
+    else if(!strcmp(f, "push"))             // --activate by pushing, from a single seed.
+    {
+        bPush = true;
+    }
+    else if(!strcmp(f, "similar"))          // answer cues with the headwords whose lists are most like theirs.
+    {
+        graphQuery = GRAPH_SIMILAR;
+    }
+    else if(!strcmp(f, "metric"))           // how --similar compares lists - cosine, jaccard or js.
+    {
+        for(similarity = 0; arg != NULL && similarity <= METRIC_JS && strcmp(arg, metricNames[similarity]); similarity++)
+        {
+        }
+        
+        if(arg == NULL || similarity > METRIC_JS)
+        {
+            usage();
+        }
+        
+        i++;
+    }
+    else if(!strcmp(f, "beam"))             // how many words each hop of a graph query goes on from.
+    {
+        if(arg == NULL)
+        {
+            usage();
+        }
+        
+        beamWidth = atoi(argv[++i]);
+    }
+    else if(!strcmp(f, "threshold"))        // the least score a graph query follows a chain for.
+    {
+        if(arg == NULL)
+        {
+            usage();
+        }
+        
+        minScore = atof(argv[++i]);
+    }
+    else if(!strcmp(f, "graph"))            // build the association graph and report its size.
+    {
+        graphInfo(arg);
+        
+        exit(0);
+    }
+    else if(!strcmp(f, "build-index"))      // rebuild (or 'check') the index files from the data.
+    {
+        bool check = arg != NULL && !strcmp(arg, "check");
+        bool same  = rebuildIndex(dataPath(SRFILE), dataPath(SRINDEX), check);
+        
+        same &= rebuildIndex(dataPath(RSFILE), dataPath(RSINDEX), check);
+        
+        exit(check && !same ? 1 : 0);
+    }
+    else if(!strcmp(f, "bench"))            // time lookups of the whole vocabulary.
+    {
+        benchFile = (char *)(arg != NULL ? arg : BENCHFILE);
+        
+        i += arg != NULL;
+    }
+    else
+    {
+        usage();
+    }
+    
+    return i;
+}
+
+
+
+
 // Function to support -i<filename> usage.
 //
 // s is a pointer to the file to read.
@@ -750,70 +11329,67 @@ void fromFile(char * s)
 
     if((fp = fopen(s, "r")) != NULL)
     {
-        char * argv[10];
-        int    argc = 0;        
+        char ** argv;
+        int     argc = 0;
         
-        char   buffer[255];
-        char * p = NULL;
+        char  * buffer;
+        char  * p = NULL;
 
-        int    n = 0;
-
-        // argv[0] is always the appname.
-        //
-        argv[0] = (char *)malloc(strlen("eatshow") + 1);
+        // Each line, and its argv, come from the arena - so a line can be any length, and have
+        // any number of args.
         //
-        strcpy(argv[0], "eatshow");
+        ArenaMark mark = arenaMark();
 
-        while(!feof(fp))
+        for(; (buffer = readLine(fp)) != NULL; arenaRelease(mark))
         {
-            // Get a line from the file.
+            argc = 0;
+            
+            // is there a lf or a cr on a seperate line?
             //
-            if(fgets(&buffer[0], 255, fp))
+            if(strlen(buffer) == 1)
             {
-                // is there a lf or a cr on a seperate line?
+                // Yes, ignore.
                 //
-			    if(strlen(buffer) == 1)
-                {
-                    // Yes, ignore.
-                    //
-                    continue;
-                }
+                continue;
+            }
             
-                // +++ This bit now parses the line, and creates the argv array.
-                //
-            	p = strtok(&buffer[0], " ");
-
-				while(p && argc != 10)
-				{
-                    argv[++argc] = (char *)malloc(strlen(p) + 1);
-                    
-                    strcpy(argv[argc], p);
-
-					p = strtok(NULL, " ");
-				}
-
-                // +++
-                
-                // Put back defaults ... number output, use tabs, demarcation etc.
-                //
-                resetFlags();
-                
-                // Call main for each suitably parsed line from the file.
-                //
-                main(argc + 1, argv);
+            // There can't be more args than there are spaces - plus argv[0], which is always the
+            // appname, and the one after the last space.
+            //
+            for(p = buffer; (p = strchr(p, ' ')) != NULL; p++)
+            {
+                argc++;
+            }
+            
+            argv = (char **)arenaAlloc((argc + 3) * sizeof(char *));
+            
+            argv[0] = (char *)"eatshow";
+            
+            argc = 0;
+            
+            // +++ This bit now parses the line, and creates the argv array.
+            //
+            p = strtok(buffer, " ");
+            
+            while(p)
+            {
+                argv[++argc] = p;
                 
-                // Tidy alloc'ed memory away.
-                //                
-                for(n = 1; n < argc; n++)
-                {
-                    free(argv[n]);
-                }
+                p = strtok(NULL, " ");
             }
-        } 
-        
-        // Free 'eatshow' alloc'ed memory.
-        //
-        free(argv[0]);
+            
+            argv[argc + 1] = NULL;
+            
+            // +++
+            
+            // Put back defaults ... number output, use tabs, demarcation etc.
+            //
+            resetFlags();
+            
+            // Call main for each suitably parsed line from the file.
+            //
+            main(argc + 1, argv);
+        }
         
         fclose(fp);
     }
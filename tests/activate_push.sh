@@ -0,0 +1,36 @@
+#!/bin/sh
+#
+# --activate's two ways must agree: for each seed, pushing and power iteration at the same
+# --tolerance, their scores for the pushed top 20 within that tolerance of each other (in all).
+#
+# Usage: tests/activate_push.sh [eatshow] [tolerance] - run from the directory with the data files.
+#
+EATSHOW=${1:-./eatshow}
+TOLERANCE=${2:-0.000001}
+
+python3 - "$EATSHOW" "$TOLERANCE" <<'PY'
+import json, subprocess, sys
+
+eatshow, tolerance = sys.argv[1], float(sys.argv[2])
+seeds = ["dog", "man", "bone", "happy", "water", "sun", "red"]
+
+def activate(options):
+    out = subprocess.run([eatshow, "--activate", "--format=jsonl", "--tolerance", str(tolerance)] + options + seeds,
+                         capture_output=True, text=True, check=True).stdout
+    return {r["cue"]: r for r in map(json.loads, out.splitlines())}
+
+push  = activate(["--push", "-l20"])
+power = activate(["--power", "-l100000"])
+bad   = 0
+
+for cue, r in push.items():
+    scores = {a["word"]: a["score"] for a in power[cue]["activations"]}
+    apart  = sum(abs(a["score"] - scores.get(a["word"], 0)) for a in r["activations"])
+    if r["method"] != "push" or len(r["activations"]) != 20 or apart > tolerance:
+        print("FAIL: %s: %s, %d words, %.3g apart" % (cue, r["method"], len(r["activations"]), apart))
+        bad += 1
+
+if bad == 0:
+    print("ok - %d seeds within %g" % (len(push), tolerance))
+sys.exit(1 if bad else 0)
+PY
@@ -0,0 +1,79 @@
+#!/bin/sh
+#
+# Many clients at once against --serve: each sends a burst of requests and hangs up, most
+# without reading the answers - so clients go while their answers are on the way.  The daemon
+# must still be running, and answering, afterwards.
+#
+# Usage: tests/serve_clients.sh [eatshow] [clients] - run from the directory with the data files.
+#
+EATSHOW=${1:-./eatshow}
+CLIENTS=${2:-16}
+SOCK=${TMPDIR:-/tmp}/eatshow-test.$$.sock
+
+"$EATSHOW" -j4 --serve "$SOCK" 2>"$SOCK.err" &
+PID=$!
+
+trap 'kill $PID 2>/dev/null; rm -f "$SOCK" "$SOCK.err"' EXIT
+
+python3 - "$SOCK" "$CLIENTS" <<'PY'
+import random, socket, sys, threading, time
+
+path, clients = sys.argv[1], int(sys.argv[2])
+
+for _ in range(100):
+    try:
+        socket.socket(socket.AF_UNIX).connect(path)
+        break
+    except OSError:
+        time.sleep(0.05)
+
+words = ["man", "dog", "happy", "zzqq", "cat", "house", "sun", "water"]
+fails = []
+
+def client(k):
+    rnd = random.Random(k)
+    for round in range(100):
+        try:
+            s = socket.socket(socket.AF_UNIX)
+            s.connect(path)
+            s.sendall("".join("%d\t%s\n" % (i, words[(i + k) % len(words)]) for i in range(rnd.randint(1, 40))).encode())
+            if round % 4 == 0:
+                s.shutdown(socket.SHUT_WR)
+                while s.recv(65536):
+                    pass
+            else:
+                time.sleep(rnd.random() * 0.002)
+            s.close()
+        except OSError as e:
+            fails.append(str(e))
+            return
+
+threads = [threading.Thread(target=client, args=(k,)) for k in range(clients)]
+for t in threads: t.start()
+for t in threads: t.join()
+
+# Still up, and still right?
+s = socket.socket(socket.AF_UNIX)
+s.connect(path)
+s.sendall(b"1\tman\n")
+s.shutdown(socket.SHUT_WR)
+answer = b""
+while True:
+    b = s.recv(65536)
+    if not b:
+        break
+    answer += b
+if not answer.startswith(b"1\t0\t") or fails:
+    print("FAIL: %r %s" % (answer[:40], fails[:3]))
+    sys.exit(1)
+PY
+STATUS=$?
+
+if ! kill -0 $PID 2>/dev/null || grep -q 'ERROR: AddressSanitizer' "$SOCK.err"; then
+    echo "FAIL: the daemon died"
+    cat "$SOCK.err"
+    exit 1
+fi
+
+[ $STATUS -eq 0 ] && echo "ok - $CLIENTS clients"
+exit $STATUS